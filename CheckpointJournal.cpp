@@ -0,0 +1,104 @@
+#include "CheckpointJournal.h"
+
+#include <iostream>
+#include <sstream>
+
+namespace {
+    const char* kJournalFormat = "NRooTrackerVtx-checkpoint-v1";
+    // Written after every record so that a line cut short by a killed job is
+    // never mistaken for a complete one
+    const char* kRecordEnd = "end";
+}
+
+CheckpointJournal::CheckpointJournal() {
+}
+
+CheckpointJournal::~CheckpointJournal() {
+    if (out.is_open()) out.close();
+}
+
+std::string CheckpointJournal::MakeKey(const WorkUnit& unit) {
+    return formatWorkUnit(unit);
+}
+
+bool CheckpointJournal::Open(const std::string& filename, const std::string& configKey) {
+    records.clear();
+    bool writeHeader = true;
+    bool needNewline = false;
+
+    std::ifstream in(filename.c_str());
+    if (in) {
+        std::string line;
+        if (std::getline(in, line)) {
+            writeHeader = false;
+            std::string expected = std::string(kJournalFormat) + " " + configKey;
+            if (line != expected) {
+                std::cerr << "Checkpoint journal " << filename << " was written with different settings:\n"
+                          << "  journal: " << line << "\n"
+                          << "  current: " << expected << "\n"
+                          << "Remove it or use another journal file." << std::endl;
+                return false;
+            }
+        }
+
+        int nBad = 0;
+        while (std::getline(in, line)) {
+            if (line.empty()) continue;
+
+            // The key is everything up to the sixth tab, the summary follows
+            size_t pos = 0;
+            int nTabs = 0;
+            while (nTabs < 6 && (pos = line.find('\t', pos)) != std::string::npos) {
+                nTabs++;
+                pos++;
+            }
+            VtxSummary summary;
+            std::string marker;
+            std::istringstream summaryStream(nTabs == 6 ? line.substr(pos) : "");
+            if (nTabs != 6 || !summary.Read(summaryStream) || !(summaryStream >> marker) || marker != kRecordEnd) {
+                nBad++;
+                continue;
+            }
+            records[line.substr(0, pos - 1)] = summary;
+        }
+        if (nBad > 0) {
+            std::cerr << "Ignored " << nBad << " incomplete record(s) in checkpoint journal " << filename << std::endl;
+        }
+
+        // A record cut short by an interrupted run has no trailing newline;
+        // terminate it so the next record starts on its own line
+        in.clear();
+        in.seekg(-1, std::ios::end);
+        char last = 0;
+        needNewline = in.get(last) && last != '\n';
+    }
+    in.close();
+
+    out.open(filename.c_str(), std::ios::app);
+    if (!out) {
+        std::cerr << "Cannot open checkpoint journal for writing: " << filename << std::endl;
+        return false;
+    }
+    if (writeHeader) {
+        out << kJournalFormat << " " << configKey << "\n";
+    } else if (needNewline) {
+        out << "\n";
+    }
+    out.flush();
+    return true;
+}
+
+bool CheckpointJournal::Find(const WorkUnit& unit, VtxSummary& summary) const {
+    std::map<std::string, VtxSummary>::const_iterator it = records.find(MakeKey(unit));
+    if (it == records.end()) return false;
+    summary = it->second;
+    return true;
+}
+
+void CheckpointJournal::Record(const WorkUnit& unit, const VtxSummary& summary) {
+    records[MakeKey(unit)] = summary;
+    out << MakeKey(unit) << '\t';
+    summary.Write(out);
+    out << ' ' << kRecordEnd << "\n";
+    out.flush();
+}
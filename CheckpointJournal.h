@@ -0,0 +1,48 @@
+#ifndef CheckpointJournal_h
+#define CheckpointJournal_h
+
+#include <fstream>
+#include <map>
+#include <string>
+
+#include "VtxSummary.h"
+#include "WorkUnit.h"
+
+// Append-only record of completed work units and their partial summaries.
+//
+// The journal is a text file. The first line holds a format tag and a
+// configuration key describing the options the partial results depend on;
+// every following line is one completed unit:
+//
+//   <path>\t<size>\t<mtime>\t<nEntries>\t<begin>\t<end>\t<summary> end
+//
+// Each line is flushed as soon as the unit finishes, so a job that is killed
+// loses at most the unit it was working on. A truncated last line is ignored
+// when the journal is loaded.
+class CheckpointJournal {
+public:
+    CheckpointJournal();
+    ~CheckpointJournal();
+
+    // Load existing records from 'filename' (if it exists) and open it for
+    // appending. Fails if the journal was written with a different
+    // configuration key.
+    bool Open(const std::string& filename, const std::string& configKey);
+
+    // Look up the stored partial summary of a unit. Units only match if the
+    // file identity and the entry range are identical.
+    bool Find(const WorkUnit& unit, VtxSummary& summary) const;
+
+    // Record a completed unit
+    void Record(const WorkUnit& unit, const VtxSummary& summary);
+
+    size_t GetNRecords() const { return records.size(); }
+
+private:
+    static std::string MakeKey(const WorkUnit& unit);
+
+    std::map<std::string, VtxSummary> records;
+    std::ofstream out;
+};
+
+#endif
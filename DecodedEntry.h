@@ -0,0 +1,26 @@
+#ifndef DecodedEntry_h
+#define DecodedEntry_h
+
+#include <vector>
+
+#include "Rtypes.h"
+#include "NRooTrackerVtx.h"
+
+// Deep copies of the vertices of one NRooTrackerVtx entry
+struct DecodedEntry {
+    Long64_t entry;
+    std::vector<ND::NRooTrackerVtx*> vertices;
+
+    DecodedEntry() : entry(-1) {}
+    ~DecodedEntry() {
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            delete vertices[i];
+        }
+    }
+
+private:
+    DecodedEntry(const DecodedEntry&);
+    DecodedEntry& operator=(const DecodedEntry&);
+};
+
+#endif
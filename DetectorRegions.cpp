@@ -0,0 +1,298 @@
+#include "DetectorRegions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    const char* AXIS_NAMES = "xyz";
+
+    // The two coordinates other than 'axis', in x, y, z order
+    void otherAxes(int axis, int& a, int& b) {
+        a = axis == 0 ? 1 : 0;
+        b = axis == 2 ? 1 : 2;
+    }
+
+    // Squared distance from (u, v) to the nearest and to the farthest point of
+    // the rectangle [u0, u1] x [v0, v1]
+    void rectangleDistances(double u, double v, double u0, double u1, double v0, double v1,
+                            double& nearest2, double& farthest2) {
+        double du = u < u0 ? u0 - u : (u > u1 ? u - u1 : 0);
+        double dv = v < v0 ? v0 - v : (v > v1 ? v - v1 : 0);
+        nearest2 = du * du + dv * dv;
+        double fu = std::max(std::fabs(u - u0), std::fabs(u - u1));
+        double fv = std::max(std::fabs(v - v0), std::fabs(v - v1));
+        farthest2 = fu * fu + fv * fv;
+    }
+
+    // How a region relates to the closed box [clo, chi]
+    enum Overlap { kOutside, kCrossing, kInside };
+
+    Overlap overlap(const DetectorRegion& region, const double* clo, const double* chi) {
+        bool inside = true;
+        for (int a = 0; a < 3; ++a) {
+            if (chi[a] < region.min[a] || clo[a] > region.max[a]) return kOutside;
+            if (clo[a] < region.min[a] || chi[a] > region.max[a]) inside = false;
+        }
+        if (region.shape == DetectorRegion::kBox) return inside ? kInside : kCrossing;
+
+        // The bounding box test above already covers the axis; the cross
+        // section is a disc
+        int a, b;
+        otherAxes(region.axis, a, b);
+        double nearest2, farthest2;
+        rectangleDistances(region.center[0], region.center[1], clo[a], chi[a], clo[b], chi[b], nearest2, farthest2);
+        double r2 = region.radius * region.radius;
+        if (nearest2 > r2) return kOutside;
+        bool alongAxis = clo[region.axis] >= region.min[region.axis] && chi[region.axis] <= region.max[region.axis];
+        return alongAxis && farthest2 <= r2 ? kInside : kCrossing;
+    }
+}
+
+bool DetectorRegion::Contains(double x, double y, double z) const {
+    double p[3] = {x, y, z};
+    if (shape == kBox) {
+        return p[0] >= min[0] && p[0] <= max[0] &&
+               p[1] >= min[1] && p[1] <= max[1] &&
+               p[2] >= min[2] && p[2] <= max[2];
+    }
+    if (p[axis] < min[axis] || p[axis] > max[axis]) return false;
+    int a, b;
+    otherAxes(axis, a, b);
+    double du = p[a] - center[0];
+    double dv = p[b] - center[1];
+    return du * du + dv * dv <= radius * radius;
+}
+
+DetectorRegions::DetectorRegions() {
+    for (int a = 0; a < 3; ++a) {
+        lo[a] = hi[a] = invCellSize[a] = 0;
+        nCells[a] = 0;
+    }
+}
+
+bool DetectorRegions::Load(const std::string& filename) {
+    std::ifstream in(filename.c_str());
+    if (!in) {
+        std::cerr << "Cannot open region file: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); ++lineNumber) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream fields(line);
+        std::string shape;
+        if (!(fields >> shape)) continue;
+
+        DetectorRegion region;
+        bool ok = false;
+        if (shape == "box") {
+            region.shape = DetectorRegion::kBox;
+            region.axis = 0;
+            region.center[0] = region.center[1] = region.radius = 0;
+            ok = (bool)(fields >> region.name >> region.min[0] >> region.max[0]
+                        >> region.min[1] >> region.max[1] >> region.min[2] >> region.max[2]);
+        } else if (shape == "cylinder") {
+            region.shape = DetectorRegion::kCylinder;
+            std::string axis;
+            double axisMin = 0, axisMax = 0;
+            ok = (bool)(fields >> region.name >> axis >> region.center[0] >> region.center[1]
+                        >> region.radius >> axisMin >> axisMax);
+            region.axis = axis.size() == 1 && axis[0] >= 'x' && axis[0] <= 'z' ? axis[0] - 'x' : -1;
+            if (ok && region.axis >= 0) {
+                int a, b;
+                otherAxes(region.axis, a, b);
+                region.min[region.axis] = axisMin;
+                region.max[region.axis] = axisMax;
+                region.min[a] = region.center[0] - region.radius;
+                region.max[a] = region.center[0] + region.radius;
+                region.min[b] = region.center[1] - region.radius;
+                region.max[b] = region.center[1] + region.radius;
+            } else {
+                ok = false;
+            }
+        }
+        std::string extra;
+        if (!ok || fields >> extra) {
+            std::cerr << filename << ":" << lineNumber << ": invalid region: " << line << std::endl;
+            return false;
+        }
+        if (!Add(region)) {
+            std::cerr << filename << ":" << lineNumber << ": region not added" << std::endl;
+            return false;
+        }
+    }
+
+    if (regions.empty()) {
+        std::cerr << "No regions in " << filename << std::endl;
+        return false;
+    }
+    Compile();
+    return true;
+}
+
+bool DetectorRegions::Add(const DetectorRegion& region) {
+    if (regions.size() >= kMaxRegions) {
+        std::cerr << "At most " << kMaxRegions << " regions are supported" << std::endl;
+        return false;
+    }
+    if (Find(region.name) >= 0) {
+        std::cerr << "Duplicate region name: " << region.name << std::endl;
+        return false;
+    }
+    for (int a = 0; a < 3; ++a) {
+        if (!(region.min[a] <= region.max[a])) {
+            std::cerr << "Region " << region.name << " has min > max along " << AXIS_NAMES[a] << std::endl;
+            return false;
+        }
+    }
+    if (region.shape == DetectorRegion::kCylinder && !(region.radius > 0)) {
+        std::cerr << "Region " << region.name << " has no positive radius" << std::endl;
+        return false;
+    }
+    regions.push_back(region);
+    return true;
+}
+
+void DetectorRegions::Compile() {
+    insideMask.clear();
+    crossingMask.clear();
+    if (regions.empty()) {
+        for (int a = 0; a < 3; ++a) nCells[a] = 0;
+        return;
+    }
+
+    for (int a = 0; a < 3; ++a) {
+        lo[a] = regions[0].min[a];
+        hi[a] = regions[0].max[a];
+        for (size_t r = 1; r < regions.size(); ++r) {
+            lo[a] = std::min(lo[a], regions[r].min[a]);
+            hi[a] = std::max(hi[a], regions[r].max[a]);
+        }
+    }
+
+    // Roughly cubic cells; a flat dimension gets a single cell
+    double volume = 1;
+    int nDims = 0;
+    for (int a = 0; a < 3; ++a) {
+        if (hi[a] > lo[a]) {
+            volume *= hi[a] - lo[a];
+            nDims++;
+        }
+    }
+    double cellSize = nDims > 0 ? std::pow(volume / kMaxCells, 1.0 / nDims) : 1;
+    for (int a = 0; a < 3; ++a) {
+        double extent = hi[a] - lo[a];
+        nCells[a] = extent > 0 ? std::max(1, (int)std::floor(extent / cellSize)) : 1;
+        invCellSize[a] = extent > 0 ? nCells[a] / extent : 0;
+    }
+
+    size_t n = (size_t)nCells[0] * nCells[1] * nCells[2];
+    insideMask.assign(n, 0);
+    crossingMask.assign(n, 0);
+    for (int ix = 0; ix < nCells[0]; ++ix) {
+        for (int iy = 0; iy < nCells[1]; ++iy) {
+            for (int iz = 0; iz < nCells[2]; ++iz) {
+                int index[3] = {ix, iy, iz};
+                double clo[3], chi[3];
+                for (int a = 0; a < 3; ++a) {
+                    double size = hi[a] - lo[a];
+                    clo[a] = lo[a] + size * index[a] / nCells[a];
+                    chi[a] = lo[a] + size * (index[a] + 1) / nCells[a];
+                }
+                size_t cell = ((size_t)ix * nCells[1] + iy) * nCells[2] + iz;
+                for (size_t r = 0; r < regions.size(); ++r) {
+                    Overlap o = overlap(regions[r], clo, chi);
+                    if (o == kInside) insideMask[cell] |= Mask(1) << r;
+                    if (o == kCrossing) crossingMask[cell] |= Mask(1) << r;
+                }
+            }
+        }
+    }
+}
+
+int DetectorRegions::Find(const std::string& name) const {
+    for (size_t r = 0; r < regions.size(); ++r) {
+        if (regions[r].name == name) return (int)r;
+    }
+    return -1;
+}
+
+DetectorRegions::Mask DetectorRegions::Lookup(int cell, double x, double y, double z) const {
+    if (cell < 0) return 0;
+    Mask mask = insideMask[cell];
+    Mask crossing = crossingMask[cell];
+    for (size_t r = 0; crossing; ++r, crossing >>= 1) {
+        if ((crossing & 1) && regions[r].Contains(x, y, z)) mask |= Mask(1) << r;
+    }
+    return mask;
+}
+
+DetectorRegions::Mask DetectorRegions::Classify(double x, double y, double z) const {
+    Mask mask = 0;
+    Classify(&x, &y, &z, 1, &mask);
+    return mask;
+}
+
+void DetectorRegions::Classify(const double* x, const double* y, const double* z, size_t n, Mask* masks) const {
+    if (insideMask.empty()) {
+        for (size_t i = 0; i < n; ++i) masks[i] = 0;
+        return;
+    }
+
+    const double maxX = nCells[0] - 1, maxY = nCells[1] - 1, maxZ = nCells[2] - 1;
+    int cells[kBlockSize];
+    for (size_t begin = 0; begin < n; begin += kBlockSize) {
+        size_t count = std::min(kBlockSize, n - begin);
+        const double* bx = x + begin;
+        const double* by = y + begin;
+        const double* bz = z + begin;
+
+        // Selects instead of branches; NaN coordinates fail the bounds test
+        for (size_t i = 0; i < count; ++i) {
+            bool inGrid = bx[i] >= lo[0] && bx[i] <= hi[0] &&
+                          by[i] >= lo[1] && by[i] <= hi[1] &&
+                          bz[i] >= lo[2] && bz[i] <= hi[2];
+            double fx = (bx[i] - lo[0]) * invCellSize[0];
+            double fy = (by[i] - lo[1]) * invCellSize[1];
+            double fz = (bz[i] - lo[2]) * invCellSize[2];
+            fx = fx > 0 ? (fx < maxX ? fx : maxX) : 0;
+            fy = fy > 0 ? (fy < maxY ? fy : maxY) : 0;
+            fz = fz > 0 ? (fz < maxZ ? fz : maxZ) : 0;
+            int cell = ((int)fx * nCells[1] + (int)fy) * nCells[2] + (int)fz;
+            cells[i] = inGrid ? cell : -1;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            masks[begin + i] = Lookup(cells[i], bx[i], by[i], bz[i]);
+        }
+    }
+}
+
+void DetectorRegions::Print(std::ostream& out) const {
+    for (size_t r = 0; r < regions.size(); ++r) {
+        const DetectorRegion& region = regions[r];
+        out << "  " << region.name << ": ";
+        if (region.shape == DetectorRegion::kBox) {
+            out << "box";
+            for (int a = 0; a < 3; ++a) {
+                out << " " << AXIS_NAMES[a] << " [" << region.min[a] << ", " << region.max[a] << "]";
+            }
+        } else {
+            out << "cylinder along " << AXIS_NAMES[region.axis] << " [" << region.min[region.axis]
+                << ", " << region.max[region.axis] << "], axis at (" << region.center[0] << ", "
+                << region.center[1] << "), radius " << region.radius;
+        }
+        out << std::endl;
+    }
+
+    size_t nCrossed = 0;
+    for (size_t c = 0; c < crossingMask.size(); ++c) {
+        if (crossingMask[c]) nCrossed++;
+    }
+    out << "  Grid: " << nCells[0] << " x " << nCells[1] << " x " << nCells[2] << " cells, "
+        << nCrossed << " crossed by a region boundary" << std::endl;
+}
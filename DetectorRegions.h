@@ -0,0 +1,92 @@
+#ifndef DetectorRegions_h
+#define DetectorRegions_h
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// A named volume of the detector, in the coordinates and units of EvtVtx
+struct DetectorRegion {
+    enum Shape { kBox, kCylinder };
+
+    std::string name;
+    Shape shape;
+    // Bounding box. For a box this is the region itself; for a cylinder the
+    // extent along 'axis' is the length of the cylinder.
+    double min[3];
+    double max[3];
+    // Cylinder only: axis (0 = x, 1 = y, 2 = z), position of the axis in the
+    // other two coordinates (in x, y, z order) and radius
+    int axis;
+    double center[2];
+    double radius;
+
+    bool Contains(double x, double y, double z) const;
+};
+
+// Set of detector regions compiled into a uniform grid for fast lookups.
+//
+// A vertex can be in several regions (e.g. a fiducial volume inside a
+// sub-detector), so a lookup returns a bit mask with bit i set for region i.
+// Every grid cell stores the regions that contain the whole cell, which need
+// no test, and the regions that only cross it, which are tested exactly.
+// Most cells are crossed by no region boundary, so most lookups are a cell
+// index computation and one load.
+class DetectorRegions {
+public:
+    typedef uint64_t Mask;
+    static const size_t kMaxRegions = 64;
+
+    DetectorRegions();
+
+    // Read regions from a text file with one region per line:
+    //
+    //   box      <name> <xmin> <xmax> <ymin> <ymax> <zmin> <zmax>
+    //   cylinder <name> <x|y|z> <center1> <center2> <radius> <min> <max>
+    //
+    // where center1, center2 locate the axis in the two other coordinates (in
+    // x, y, z order) and min, max bound the cylinder along its axis. Text from
+    // '#' to the end of a line is a comment. The grid is compiled on success.
+    bool Load(const std::string& filename);
+
+    // Add a region; Compile() must be called before the next lookup
+    bool Add(const DetectorRegion& region);
+    void Compile();
+
+    size_t GetNRegions() const { return regions.size(); }
+    const DetectorRegion& GetRegion(size_t i) const { return regions[i]; }
+    // Index of the region with this name, -1 if there is none
+    int Find(const std::string& name) const;
+
+    // Regions containing one point
+    Mask Classify(double x, double y, double z) const;
+
+    // Regions containing each of n points given as separate coordinate
+    // arrays. The cell indices of a block of points are computed first in a
+    // branch free loop the compiler can vectorise, then the cells are looked up.
+    void Classify(const double* x, const double* y, const double* z, size_t n, Mask* masks) const;
+
+    void Print(std::ostream& out) const;
+
+private:
+    // Points classified together by the batch lookup
+    static const size_t kBlockSize = 256;
+    // Upper bound on the number of grid cells
+    static const size_t kMaxCells = 32768;
+
+    Mask Lookup(int cell, double x, double y, double z) const;
+
+    std::vector<DetectorRegion> regions;
+
+    // Grid over the bounding box of all regions
+    double lo[3];
+    double hi[3];
+    double invCellSize[3];
+    int nCells[3];
+    std::vector<Mask> insideMask;   // regions containing the whole cell
+    std::vector<Mask> crossingMask; // regions containing part of the cell
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include "EntryBrowser.h"
+
+#include <iostream>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TClonesArray.h"
+
+#include "NRooTrackerVtx.h"
+
+EntryBrowser::EntryBrowser(TTree* nuTree, const std::string& filename_, int prefetchDepth_, size_t cacheSize_) :
+    tree(nuTree),
+    nRooVtxs(new TClonesArray("ND::NRooTrackerVtx")),
+    NRooVtx(0),
+    filename(filename_),
+    nEntries(nuTree->GetEntries()),
+    prefetchDepth(prefetchDepth_),
+    cacheSize(cacheSize_ > (size_t)prefetchDepth_ + 1 ? cacheSize_ : prefetchDepth_ + 2),
+    stop(false),
+    urgent(-1),
+    indexStarted(false),
+    indexDone(false),
+    indexOk(false),
+    stopIndex(false)
+{
+    tree->SetBranchAddress("Vtx", &nRooVtxs);
+    tree->SetBranchAddress("NVtx", &NRooVtx);
+
+    decoderThread = std::thread(&EntryBrowser::DecodeLoop, this);
+}
+
+EntryBrowser::~EntryBrowser() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    stopIndex = true;
+    wakeDecoder.notify_all();
+    decoderThread.join();
+    if (indexThread.joinable()) indexThread.join();
+
+    tree->ResetBranchAddresses();
+    delete nRooVtxs;
+}
+
+std::shared_ptr<const DecodedEntry> EntryBrowser::Lookup(Long64_t entry) {
+    // Caller holds the mutex
+    std::map<Long64_t, std::pair<std::shared_ptr<const DecodedEntry>, std::list<Long64_t>::iterator> >::iterator it = cache.find(entry);
+    if (it == cache.end()) return std::shared_ptr<const DecodedEntry>();
+    lruOrder.splice(lruOrder.begin(), lruOrder, it->second.second);
+    return it->second.first;
+}
+
+void EntryBrowser::Insert(const std::shared_ptr<const DecodedEntry>& decoded) {
+    // Caller holds the mutex
+    if (cache.find(decoded->entry) != cache.end()) return;
+    lruOrder.push_front(decoded->entry);
+    cache[decoded->entry] = std::make_pair(decoded, lruOrder.begin());
+    while (cache.size() > cacheSize) {
+        cache.erase(lruOrder.back());
+        lruOrder.pop_back();
+    }
+}
+
+std::shared_ptr<const DecodedEntry> EntryBrowser::Get(Long64_t entry) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Decode ahead of the user; previously queued entries that are no longer
+    // near the current position are dropped
+    prefetch.clear();
+    for (int i = 1; i <= prefetchDepth && entry + i < nEntries; ++i) {
+        if (cache.find(entry + i) == cache.end()) {
+            prefetch.push_back(entry + i);
+        }
+    }
+
+    std::shared_ptr<const DecodedEntry> decoded = Lookup(entry);
+    if (!decoded) {
+        urgent = entry;
+        wakeDecoder.notify_all();
+        while (!(decoded = Lookup(entry))) {
+            entryReady.wait(lock);
+        }
+        urgent = -1;
+    }
+    wakeDecoder.notify_all();
+    return decoded;
+}
+
+std::shared_ptr<const DecodedEntry> EntryBrowser::Decode(Long64_t entry) {
+    // Only called from the decoder thread, which owns the tree
+    nRooVtxs->Clear();
+    tree->GetEntry(entry);
+
+    std::shared_ptr<DecodedEntry> decoded(new DecodedEntry());
+    decoded->entry = entry;
+    for (int i = 0; i < NRooVtx; ++i) {
+        ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+        decoded->vertices.push_back(vtx ? new ND::NRooTrackerVtx(*vtx) : nullptr);
+    }
+    return decoded;
+}
+
+void EntryBrowser::DecodeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop) {
+        // The entry the user is waiting for goes first
+        Long64_t next = -1;
+        if (urgent >= 0 && cache.find(urgent) == cache.end()) {
+            next = urgent;
+        } else {
+            while (!prefetch.empty() && next < 0) {
+                Long64_t candidate = prefetch.front();
+                prefetch.pop_front();
+                if (cache.find(candidate) == cache.end()) next = candidate;
+            }
+        }
+
+        if (next < 0) {
+            wakeDecoder.wait(lock);
+            continue;
+        }
+
+        lock.unlock();
+        std::shared_ptr<const DecodedEntry> decoded = Decode(next);
+        lock.lock();
+
+        Insert(decoded);
+        entryReady.notify_all();
+    }
+}
+
+void EntryBrowser::IndexLoop() {
+    std::map<int, Long64_t> index;
+    bool ok = false;
+
+    // A separate TFile, so reading the EvtNum column never competes with the
+    // decoder thread for the tree
+    TFile* file = TFile::Open(filename.c_str(), "READ");
+    TTree* indexTree = (file && !file->IsZombie()) ? (TTree*)file->Get("NRooTrackerVtx") : nullptr;
+    if (indexTree) {
+        TClonesArray* vtxs = new TClonesArray("ND::NRooTrackerVtx");
+        int nVtx = 0;
+        indexTree->SetBranchStatus("*", 0);
+        indexTree->SetBranchStatus("NVtx", 1);
+        indexTree->SetBranchStatus("Vtx.EvtNum", 1);
+        indexTree->SetBranchAddress("Vtx", &vtxs);
+        indexTree->SetBranchAddress("NVtx", &nVtx);
+
+        Long64_t n = indexTree->GetEntries();
+        Long64_t entry = 0;
+        for (; entry < n && !stopIndex; ++entry) {
+            vtxs->Clear();
+            indexTree->GetEntry(entry);
+            for (int i = 0; i < nVtx; ++i) {
+                ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)vtxs->At(i);
+                // insert() keeps the first entry of an EvtNum
+                if (vtx) index.insert(std::make_pair(vtx->EvtNum, entry));
+            }
+        }
+        ok = (entry == n);
+
+        indexTree->ResetBranchAddresses();
+        delete vtxs;
+    }
+    if (file) {
+        file->Close();
+        delete file;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    evtNumIndex.swap(index);
+    indexOk = ok;
+    indexDone = true;
+    indexReady.notify_all();
+}
+
+bool EntryBrowser::FindEvtNum(int evtNum, Long64_t& entry) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!indexStarted) {
+        indexStarted = true;
+        indexThread = std::thread(&EntryBrowser::IndexLoop, this);
+    }
+    if (!indexDone) {
+        std::cout << "Waiting for the EvtNum index to be built..." << std::endl;
+        while (!indexDone) {
+            indexReady.wait(lock);
+        }
+    }
+    if (!indexOk) {
+        std::cerr << "EvtNum index could not be built" << std::endl;
+        return false;
+    }
+    std::map<int, Long64_t>::const_iterator it = evtNumIndex.find(evtNum);
+    if (it == evtNumIndex.end()) return false;
+    entry = it->second;
+    return true;
+}
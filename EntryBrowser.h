@@ -0,0 +1,93 @@
+#ifndef EntryBrowser_h
+#define EntryBrowser_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Rtypes.h"
+#include "DecodedEntry.h"
+
+class TTree;
+class TClonesArray;
+
+// Random access to decoded entries for the interactive loop.
+//
+// A background thread owns all reads of the tree: it decodes the requested
+// entry first and then the next few entries, while the user is still reading
+// the current one. Decoded entries are kept in a small LRU cache so stepping
+// back and forth does not decode again. The first FindEvtNum() starts a
+// second thread, which reads only the EvtNum column (through its own TFile)
+// to build the EvtNum -> entry index.
+//
+// Once the browser is constructed, the tree must not be touched by anyone
+// else until the browser is destroyed. ROOT::EnableThreadSafety() must have
+// been called.
+class EntryBrowser {
+public:
+    EntryBrowser(TTree* nuTree, const std::string& filename, int prefetchDepth = 4, size_t cacheSize = 32);
+    ~EntryBrowser();
+
+    // The decoded entry, waiting for the background thread if necessary.
+    // Also schedules the entries following 'entry' for prefetching.
+    std::shared_ptr<const DecodedEntry> Get(Long64_t entry);
+
+    // First entry containing a vertex with this EvtNum. Builds the index on
+    // the first call and waits for it to be complete. Returns false if no
+    // vertex has this EvtNum.
+    bool FindEvtNum(int evtNum, Long64_t& entry);
+
+    Long64_t GetEntries() const { return nEntries; }
+
+private:
+    EntryBrowser(const EntryBrowser&);
+    EntryBrowser& operator=(const EntryBrowser&);
+
+    void DecodeLoop();
+    void IndexLoop();
+    std::shared_ptr<const DecodedEntry> Decode(Long64_t entry);
+    void Insert(const std::shared_ptr<const DecodedEntry>& decoded);
+    std::shared_ptr<const DecodedEntry> Lookup(Long64_t entry);
+
+    TTree* tree;
+    TClonesArray* nRooVtxs;
+    int NRooVtx;
+    std::string filename;
+    Long64_t nEntries;
+    int prefetchDepth;
+    size_t cacheSize;
+
+    std::mutex mutex;
+    std::condition_variable wakeDecoder;
+    std::condition_variable entryReady;
+    bool stop;
+
+    // Entry the main thread is waiting for (-1 if none) and entries to decode
+    // ahead of time
+    Long64_t urgent;
+    std::deque<Long64_t> prefetch;
+
+    // LRU cache: most recently used first
+    std::list<Long64_t> lruOrder;
+    std::map<Long64_t, std::pair<std::shared_ptr<const DecodedEntry>, std::list<Long64_t>::iterator> > cache;
+
+    // EvtNum index, built by indexThread once it is first needed
+    std::map<int, Long64_t> evtNumIndex;
+    bool indexStarted;
+    bool indexDone;
+    bool indexOk;
+    std::condition_variable indexReady;
+    std::atomic<bool> stopIndex;
+
+    std::thread decoderThread;
+    std::thread indexThread;
+};
+
+#endif
@@ -0,0 +1,370 @@
+#include "FlatEventStore.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const FlatColumnSpec FLAT_COLUMNS[kNFlatColumns] = {
+    {"Entry",        kFlatInt64,  1, kPerVertex},
+    {"VtxIndex",     kFlatInt32,  1, kPerVertex},
+    {"EvtNum",       kFlatInt32,  1, kPerVertex},
+    {"EvtXSec",      kFlatDouble, 1, kPerVertex},
+    {"EvtWght",      kFlatDouble, 1, kPerVertex},
+    {"EvtVtx",       kFlatDouble, 4, kPerVertex},
+    {"NuEnusk",      kFlatFloat,  1, kPerVertex},
+    {"NuParentPdg",  kFlatInt32,  1, kPerVertex},
+    {"StdHepOffset", kFlatUInt64, 1, kVertexOffsets},
+    {"NFOffset",     kFlatUInt64, 1, kVertexOffsets},
+    {"StdHepPdg",    kFlatInt32,  1, kPerParticle},
+    {"StdHepStatus", kFlatInt32,  1, kPerParticle},
+    {"StdHepP4",     kFlatDouble, 4, kPerParticle},
+    {"StdHepX4",     kFlatDouble, 4, kPerParticle},
+    {"NFiflag",      kFlatInt32,  1, kPerNF},
+    {"NFx",          kFlatFloat,  1, kPerNF},
+    {"NFy",          kFlatFloat,  1, kPerNF},
+    {"NFz",          kFlatFloat,  1, kPerNF},
+    {"NFpx",         kFlatFloat,  1, kPerNF},
+    {"NFpy",         kFlatFloat,  1, kPerNF},
+    {"NFpz",         kFlatFloat,  1, kPerNF},
+    {"NFe",          kFlatFloat,  1, kPerNF},
+    {"NFfirststep",  kFlatInt32,  1, kPerNF}
+};
+
+namespace {
+    const char FLAT_MAGIC[8] = {'N', 'R', 'T', 'V', 'F', 'L', 'A', 'T'};
+    const uint32_t FLAT_VERSION = 1;
+    const uint32_t FLAT_BYTE_ORDER = 0x01020304;
+    const uint64_t FLAT_ALIGNMENT = 64;
+
+    size_t typeSize(uint32_t type) {
+        switch (type) {
+            case kFlatInt32:  return 4;
+            case kFlatInt64:  return 8;
+            case kFlatUInt64: return 8;
+            case kFlatFloat:  return 4;
+            case kFlatDouble: return 8;
+        }
+        return 0;
+    }
+
+    size_t rowSize(const FlatColumnSpec& spec) {
+        return typeSize(spec.type) * spec.width;
+    }
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + FLAT_ALIGNMENT - 1) / FLAT_ALIGNMENT * FLAT_ALIGNMENT;
+    }
+
+    uint64_t expectedRows(FlatColumnExtent extent, const FlatFileHeader& header) {
+        switch (extent) {
+            case kPerVertex:     return header.nVertices;
+            case kVertexOffsets: return header.nVertices + 1;
+            case kPerParticle:   return header.nParticles;
+            case kPerNF:         return header.nNF;
+        }
+        return 0;
+    }
+
+    // Offsets of the rows of every vertex: starting at 0, never decreasing
+    // and ending at the number of rows, so no vertex view leaves the column
+    bool validOffsets(const uint64_t* offsets, uint64_t nVertices, uint64_t nRows) {
+        if (offsets[0] != 0 || offsets[nVertices] != nRows) return false;
+        for (uint64_t i = 0; i < nVertices; ++i) {
+            if (offsets[i + 1] < offsets[i]) return false;
+        }
+        return true;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// FlatEventStore
+
+FlatEventStore::FlatEventStore() :
+    fd(-1),
+    mapping(nullptr),
+    mappingSize(0),
+    header(nullptr)
+{
+    for (int i = 0; i < kNFlatColumns; ++i) {
+        columns[i] = nullptr;
+        rows[i] = 0;
+    }
+}
+
+FlatEventStore::~FlatEventStore() {
+    Close();
+}
+
+void FlatEventStore::Close() {
+    if (mapping) munmap((void*)mapping, mappingSize);
+    if (fd >= 0) close(fd);
+    fd = -1;
+    mapping = nullptr;
+    mappingSize = 0;
+    header = nullptr;
+    for (int i = 0; i < kNFlatColumns; ++i) {
+        columns[i] = nullptr;
+        rows[i] = 0;
+    }
+}
+
+bool FlatEventStore::Open(const std::string& filename) {
+    Close();
+
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open flat event store: " << filename << std::endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FlatFileHeader)) {
+        std::cerr << "Not a flat event store: " << filename << std::endl;
+        Close();
+        return false;
+    }
+    mappingSize = st.st_size;
+    void* address = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        std::cerr << "Cannot map flat event store: " << filename << std::endl;
+        mapping = nullptr;
+        Close();
+        return false;
+    }
+    mapping = (const char*)address;
+    header = (const FlatFileHeader*)mapping;
+
+    if (memcmp(header->magic, FLAT_MAGIC, sizeof(FLAT_MAGIC)) != 0 ||
+        header->byteOrder != FLAT_BYTE_ORDER || header->version != FLAT_VERSION) {
+        std::cerr << "Not a flat event store (or written with another version or byte order): " << filename << std::endl;
+        Close();
+        return false;
+    }
+    if (sizeof(FlatFileHeader) + (uint64_t)header->nColumns * sizeof(FlatColumnHeader) > mappingSize) {
+        std::cerr << "Truncated flat event store: " << filename << std::endl;
+        Close();
+        return false;
+    }
+
+    // Locate every column of the compiled schema by name and check that the
+    // file agrees on its type, width, extent and size
+    const FlatColumnHeader* fileColumns = (const FlatColumnHeader*)(mapping + sizeof(FlatFileHeader));
+    for (int id = 0; id < kNFlatColumns; ++id) {
+        const FlatColumnSpec& spec = FLAT_COLUMNS[id];
+        const FlatColumnHeader* found = nullptr;
+        for (uint32_t c = 0; c < header->nColumns; ++c) {
+            if (strncmp(fileColumns[c].name, spec.name, sizeof(fileColumns[c].name)) == 0) {
+                found = &fileColumns[c];
+                break;
+            }
+        }
+        if (!found) {
+            std::cerr << "Column " << spec.name << " missing in " << filename << std::endl;
+            Close();
+            return false;
+        }
+        if (found->type != (uint32_t)spec.type || found->width != spec.width ||
+            found->extent != (uint32_t)spec.extent || found->rows != expectedRows(spec.extent, *header) ||
+            found->offset % FLAT_ALIGNMENT != 0 || found->offset > mappingSize ||
+            found->rows > (mappingSize - found->offset) / rowSize(spec)) {
+            std::cerr << "Column " << spec.name << " has an unexpected layout in " << filename << std::endl;
+            Close();
+            return false;
+        }
+        columns[id] = mapping + found->offset;
+        rows[id] = found->rows;
+    }
+
+    if (!validOffsets((const uint64_t*)columns[kColStdHepOffset], header->nVertices, header->nParticles) ||
+        !validOffsets((const uint64_t*)columns[kColNFOffset], header->nVertices, header->nNF)) {
+        std::cerr << "Inconsistent offsets in " << filename << std::endl;
+        Close();
+        return false;
+    }
+
+    // Vertices are usually visited in order
+    madvise(address, mappingSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+FlatVertexView FlatEventStore::Vertex(uint64_t i) const {
+    FlatVertexView v;
+    v.entry = ((const int64_t*)columns[kColEntry])[i];
+    v.vtxIndex = ((const int32_t*)columns[kColVtxIndex])[i];
+    v.evtNum = ((const int32_t*)columns[kColEvtNum])[i];
+    v.evtXSec = ((const double*)columns[kColEvtXSec])[i];
+    v.evtWght = ((const double*)columns[kColEvtWght])[i];
+    v.evtVtx = ((const FlatVec4*)columns[kColEvtVtx])[i];
+    v.nuEnusk = ((const float*)columns[kColNuEnusk])[i];
+    v.nuParentPdg = ((const int32_t*)columns[kColNuParentPdg])[i];
+
+    uint64_t p0 = ((const uint64_t*)columns[kColStdHepOffset])[i];
+    uint64_t np = ((const uint64_t*)columns[kColStdHepOffset])[i + 1] - p0;
+    v.stdHepPdg = FlatSpan<int32_t>((const int32_t*)columns[kColStdHepPdg] + p0, np);
+    v.stdHepStatus = FlatSpan<int32_t>((const int32_t*)columns[kColStdHepStatus] + p0, np);
+    v.stdHepP4 = FlatSpan<FlatVec4>((const FlatVec4*)columns[kColStdHepP4] + p0, np);
+    v.stdHepX4 = FlatSpan<FlatVec4>((const FlatVec4*)columns[kColStdHepX4] + p0, np);
+
+    uint64_t f0 = ((const uint64_t*)columns[kColNFOffset])[i];
+    uint64_t nf = ((const uint64_t*)columns[kColNFOffset])[i + 1] - f0;
+    v.nfIflag = FlatSpan<int32_t>((const int32_t*)columns[kColNFiflag] + f0, nf);
+    v.nfX = FlatSpan<float>((const float*)columns[kColNFx] + f0, nf);
+    v.nfY = FlatSpan<float>((const float*)columns[kColNFy] + f0, nf);
+    v.nfZ = FlatSpan<float>((const float*)columns[kColNFz] + f0, nf);
+    v.nfPx = FlatSpan<float>((const float*)columns[kColNFpx] + f0, nf);
+    v.nfPy = FlatSpan<float>((const float*)columns[kColNFpy] + f0, nf);
+    v.nfPz = FlatSpan<float>((const float*)columns[kColNFpz] + f0, nf);
+    v.nfE = FlatSpan<float>((const float*)columns[kColNFe] + f0, nf);
+    v.nfFirstStep = FlatSpan<int32_t>((const int32_t*)columns[kColNFfirststep] + f0, nf);
+    return v;
+}
+
+// ---------------------------------------------------------------------------
+// FlatEventWriter
+
+FlatEventWriter::FlatEventWriter() :
+    nVertices(0),
+    nParticles(0),
+    nNF(0),
+    ok(false)
+{
+    for (int i = 0; i < kNFlatColumns; ++i) {
+        files[i] = nullptr;
+        rows[i] = 0;
+    }
+}
+
+FlatEventWriter::~FlatEventWriter() {
+    Abort();
+}
+
+std::string FlatEventWriter::TempName(int id) const {
+    return filename + ".tmp." + FLAT_COLUMNS[id].name;
+}
+
+void FlatEventWriter::Abort() {
+    for (int i = 0; i < kNFlatColumns; ++i) {
+        if (files[i]) {
+            std::fclose(files[i]);
+            files[i] = nullptr;
+            std::remove(TempName(i).c_str());
+        }
+    }
+    ok = false;
+}
+
+bool FlatEventWriter::Open(const std::string& name) {
+    Abort();
+    filename = name;
+    nVertices = nParticles = nNF = 0;
+
+    ok = true;
+    for (int i = 0; i < kNFlatColumns; ++i) {
+        rows[i] = 0;
+        files[i] = std::fopen(TempName(i).c_str(), "wb+");
+        if (!files[i]) {
+            std::cerr << "Cannot create temporary file " << TempName(i) << std::endl;
+            Abort();
+            return false;
+        }
+    }
+
+    // Offset arrays start with the begin of the first vertex
+    uint64_t zero = 0;
+    Append(kColStdHepOffset, &zero, 1);
+    Append(kColNFOffset, &zero, 1);
+    return ok;
+}
+
+void FlatEventWriter::Append(FlatColumnId id, const void* values, size_t n) {
+    if (!ok || n == 0) return;
+    if (std::fwrite(values, rowSize(FLAT_COLUMNS[id]), n, files[id]) != n) {
+        std::cerr << "Write error on " << TempName(id) << std::endl;
+        ok = false;
+    }
+    rows[id] += n;
+}
+
+void FlatEventWriter::EndVertex(uint64_t vertexParticles, uint64_t vertexNF) {
+    nVertices++;
+    nParticles += vertexParticles;
+    nNF += vertexNF;
+    Append(kColStdHepOffset, &nParticles, 1);
+    Append(kColNFOffset, &nNF, 1);
+}
+
+bool FlatEventWriter::Finish() {
+    if (!ok) {
+        Abort();
+        return false;
+    }
+
+    FlatFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC));
+    header.version = FLAT_VERSION;
+    header.byteOrder = FLAT_BYTE_ORDER;
+    header.nColumns = kNFlatColumns;
+    header.nVertices = nVertices;
+    header.nParticles = nParticles;
+    header.nNF = nNF;
+
+    FlatColumnHeader columnHeaders[kNFlatColumns];
+    uint64_t position = alignUp(sizeof(FlatFileHeader) + sizeof(columnHeaders));
+    header.headerSize = (uint32_t)position;
+    for (int i = 0; i < kNFlatColumns; ++i) {
+        const FlatColumnSpec& spec = FLAT_COLUMNS[i];
+        if (rows[i] != expectedRows(spec.extent, header)) {
+            std::cerr << "Column " << spec.name << " has " << rows[i] << " rows, expected "
+                      << expectedRows(spec.extent, header) << std::endl;
+            Abort();
+            return false;
+        }
+        memset(&columnHeaders[i], 0, sizeof(FlatColumnHeader));
+        strncpy(columnHeaders[i].name, spec.name, sizeof(columnHeaders[i].name) - 1);
+        columnHeaders[i].type = spec.type;
+        columnHeaders[i].width = spec.width;
+        columnHeaders[i].extent = spec.extent;
+        columnHeaders[i].offset = position;
+        columnHeaders[i].rows = rows[i];
+        position = alignUp(position + rows[i] * rowSize(spec));
+    }
+
+    std::string tmpName = filename + ".tmp";
+    std::FILE* out = std::fopen(tmpName.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Cannot create " << tmpName << std::endl;
+        Abort();
+        return false;
+    }
+
+    bool written = std::fwrite(&header, sizeof(header), 1, out) == 1 &&
+                   std::fwrite(columnHeaders, sizeof(columnHeaders), 1, out) == 1;
+
+    std::vector<char> buffer(1 << 20);
+    for (int i = 0; written && i < kNFlatColumns; ++i) {
+        // Pad up to the column start
+        long padding = (long)columnHeaders[i].offset - std::ftell(out);
+        for (; written && padding > 0; --padding) {
+            written = std::fputc(0, out) != EOF;
+        }
+
+        std::rewind(files[i]);
+        size_t n;
+        while (written && (n = std::fread(&buffer[0], 1, buffer.size(), files[i])) > 0) {
+            written = std::fwrite(&buffer[0], 1, n, out) == n;
+        }
+    }
+    written = (std::fclose(out) == 0) && written;
+
+    Abort();
+    if (!written || std::rename(tmpName.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Cannot write flat event store " << filename << std::endl;
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    return true;
+}
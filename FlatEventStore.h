@@ -0,0 +1,217 @@
+#ifndef FlatEventStore_h
+#define FlatEventStore_h
+
+// Memory-mappable columnar copy of NRooTrackerVtx vertices.
+//
+// This file and FlatEventStore.cpp do not depend on ROOT, so fit loops and
+// other tools can read exported vertices without ROOT being installed.
+//
+// File layout (native byte order, checked through FlatFileHeader::byteOrder):
+//
+//   FlatFileHeader
+//   FlatColumnHeader[nColumns]     schema: name, type, width, extent, location
+//   column data                    each column starts on a 64 byte boundary
+//
+// Every vertex has one row in the kPerVertex columns. Particle (StdHep) and
+// NEUT final state (NF) data are stored as flat kPerParticle / kPerNF
+// columns; vertex i owns rows [StdHepOffset[i], StdHepOffset[i+1]) and
+// [NFOffset[i], NFOffset[i+1]) of them.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+enum FlatColumnType {
+    kFlatInt32 = 1,
+    kFlatInt64 = 2,
+    kFlatUInt64 = 3,
+    kFlatFloat = 4,
+    kFlatDouble = 5
+};
+
+enum FlatColumnExtent {
+    kPerVertex = 1,       // nVertices rows
+    kVertexOffsets = 2,   // nVertices + 1 rows
+    kPerParticle = 3,     // nParticles rows
+    kPerNF = 4            // nNF rows
+};
+
+// Columns in the order they are stored
+enum FlatColumnId {
+    kColEntry = 0,        // int64: NRooTrackerVtx tree entry
+    kColVtxIndex,         // int32: index of the vertex within the entry
+    kColEvtNum,
+    kColEvtXSec,
+    kColEvtWght,
+    kColEvtVtx,           // double[4]
+    kColNuEnusk,
+    kColNuParentPdg,
+    kColStdHepOffset,     // uint64, nVertices + 1
+    kColNFOffset,         // uint64, nVertices + 1
+    kColStdHepPdg,
+    kColStdHepStatus,
+    kColStdHepP4,         // double[4]
+    kColStdHepX4,         // double[4]
+    kColNFiflag,
+    kColNFx,
+    kColNFy,
+    kColNFz,
+    kColNFpx,
+    kColNFpy,
+    kColNFpz,
+    kColNFe,
+    kColNFfirststep,
+    kNFlatColumns
+};
+
+struct FlatColumnSpec {
+    const char* name;
+    FlatColumnType type;
+    uint32_t width;       // values per row
+    FlatColumnExtent extent;
+};
+
+// Schema of the columns, indexed by FlatColumnId
+extern const FlatColumnSpec FLAT_COLUMNS[kNFlatColumns];
+
+struct FlatFileHeader {
+    char magic[8];        // "NRTVFLAT"
+    uint32_t version;
+    uint32_t byteOrder;   // 0x01020304 written natively
+    uint32_t nColumns;
+    uint32_t headerSize;  // bytes up to the first column
+    uint64_t nVertices;
+    uint64_t nParticles;
+    uint64_t nNF;
+};
+
+struct FlatColumnHeader {
+    char name[32];
+    uint32_t type;
+    uint32_t width;
+    uint32_t extent;
+    uint32_t reserved;
+    uint64_t offset;      // from the start of the file
+    uint64_t rows;
+};
+
+// Read-only view of 'size' consecutive rows of a column
+template <class T>
+struct FlatSpan {
+    const T* data;
+    size_t size;
+
+    FlatSpan() : data(nullptr), size(0) {}
+    FlatSpan(const T* d, size_t n) : data(d), size(n) {}
+
+    const T& operator[](size_t i) const { return data[i]; }
+    const T* begin() const { return data; }
+    const T* end() const { return data + size; }
+    bool empty() const { return size == 0; }
+};
+
+typedef double FlatVec4[4];
+
+// All data of one vertex. Every member points into the mapping.
+struct FlatVertexView {
+    int64_t entry;
+    int32_t vtxIndex;
+    int32_t evtNum;
+    double evtXSec;
+    double evtWght;
+    const double* evtVtx;  // x, y, z, t
+    float nuEnusk;
+    int32_t nuParentPdg;
+
+    FlatSpan<int32_t> stdHepPdg;
+    FlatSpan<int32_t> stdHepStatus;
+    FlatSpan<FlatVec4> stdHepP4;
+    FlatSpan<FlatVec4> stdHepX4;
+
+    FlatSpan<int32_t> nfIflag;
+    FlatSpan<float> nfX;
+    FlatSpan<float> nfY;
+    FlatSpan<float> nfZ;
+    FlatSpan<float> nfPx;
+    FlatSpan<float> nfPy;
+    FlatSpan<float> nfPz;
+    FlatSpan<float> nfE;
+    FlatSpan<int32_t> nfFirstStep;
+};
+
+// Zero-copy reader. The file is mapped read-only; all views stay valid until
+// Close() or destruction.
+class FlatEventStore {
+public:
+    FlatEventStore();
+    ~FlatEventStore();
+
+    bool Open(const std::string& filename);
+    void Close();
+
+    uint64_t GetNVertices() const { return header ? header->nVertices : 0; }
+    uint64_t GetNParticles() const { return header ? header->nParticles : 0; }
+    uint64_t GetNNF() const { return header ? header->nNF : 0; }
+
+    // Whole column; T must match the column type and width
+    // (e.g. FlatVec4 for kColEvtVtx / kColStdHepP4)
+    template <class T>
+    FlatSpan<T> Column(FlatColumnId id) const {
+        return FlatSpan<T>((const T*)columns[id], rows[id]);
+    }
+
+    FlatVertexView Vertex(uint64_t i) const;
+
+private:
+    FlatEventStore(const FlatEventStore&);
+    FlatEventStore& operator=(const FlatEventStore&);
+
+    int fd;
+    const char* mapping;
+    size_t mappingSize;
+    const FlatFileHeader* header;
+    const void* columns[kNFlatColumns];
+    uint64_t rows[kNFlatColumns];
+};
+
+// Streaming writer. Every column is written to its own temporary file while
+// vertices are added; Finish() assembles the final file.
+class FlatEventWriter {
+public:
+    FlatEventWriter();
+    ~FlatEventWriter();
+
+    bool Open(const std::string& filename);
+
+    // Append 'n' rows to a column. Per-vertex columns take one row per vertex,
+    // per-particle and per-NF columns the rows of the current vertex.
+    void Append(FlatColumnId id, const void* values, size_t n);
+
+    // Close the current vertex, which owns 'nParticles' StdHep rows and 'nNF'
+    // NF rows appended since the previous call
+    void EndVertex(uint64_t nParticles, uint64_t nNF);
+
+    // Write the final file and remove the temporary files
+    bool Finish();
+
+    uint64_t GetNVertices() const { return nVertices; }
+
+private:
+    FlatEventWriter(const FlatEventWriter&);
+    FlatEventWriter& operator=(const FlatEventWriter&);
+
+    std::string TempName(int id) const;
+    void Abort();
+
+    std::string filename;
+    std::FILE* files[kNFlatColumns];
+    uint64_t rows[kNFlatColumns];
+    uint64_t nVertices;
+    uint64_t nParticles;
+    uint64_t nNF;
+    bool ok;
+};
+
+#endif
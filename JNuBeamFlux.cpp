@@ -22,7 +22,8 @@ namespace ND {
         NuTuneid(0),
         NuNtrig(0),
         NuPint(0),
-        NuRand(0)
+        NuRand(0),
+        NuFileNameId(kNoString)
     {
         // Initialize arrays
         for (int i = 0; i < 4; ++i) {
@@ -65,6 +66,7 @@ namespace ND {
 
     JNuBeamFlux::JNuBeamFlux(const JNuBeamFlux& other) : RooTrackerVtxBase(other),
         NuFluxEntry(other.NuFluxEntry),
+        NuFileName(nullptr),
         NuParentPdg(other.NuParentPdg),
         NuParentDecMode(other.NuParentDecMode),
         NuCospibm(other.NuCospibm),
@@ -82,12 +84,40 @@ namespace ND {
         NuTuneid(other.NuTuneid),
         NuNtrig(other.NuNtrig),
         NuPint(other.NuPint),
-        NuRand(other.NuRand)
+        NuRand(other.NuRand),
+        NuFileNameId(other.NuFileNameId)
     {
-        // Deep copy for TObjString
-        NuFileName = (other.NuFileName) ? (TObjString*)other.NuFileName->Clone() : nullptr;
-        
-        // Copy arrays
+        // The copy only carries the pooled string (see RestoreStrings())
+        CopyFixedArrays(other);
+    }
+
+    JNuBeamFlux::JNuBeamFlux(JNuBeamFlux&& other) : RooTrackerVtxBase(other),
+        NuFluxEntry(other.NuFluxEntry),
+        NuFileName(nullptr),
+        NuParentPdg(other.NuParentPdg),
+        NuParentDecMode(other.NuParentDecMode),
+        NuCospibm(other.NuCospibm),
+        NuNorm(other.NuNorm),
+        NuCospi0bm(other.NuCospi0bm),
+        NuRnu(other.NuRnu),
+        NuIdfd(other.NuIdfd),
+        NuGipart(other.NuGipart),
+        NuGamom0(other.NuGamom0),
+        NuNg(other.NuNg),
+        NuEnusk(other.NuEnusk),
+        NuNormsk(other.NuNormsk),
+        NuAnorm(other.NuAnorm),
+        NuVersion(other.NuVersion),
+        NuTuneid(other.NuTuneid),
+        NuNtrig(other.NuNtrig),
+        NuPint(other.NuPint),
+        NuRand(other.NuRand),
+        NuFileNameId(other.NuFileNameId)
+    {
+        CopyFixedArrays(other);
+    }
+
+    void JNuBeamFlux::CopyFixedArrays(const JNuBeamFlux& other) {
         for (int i = 0; i < 4; ++i) {
             NuParentDecP4[i] = other.NuParentDecP4[i];
             NuParentDecX4[i] = other.NuParentDecX4[i];
@@ -130,4 +160,8 @@ namespace ND {
         // Clean up dynamically allocated memory
         if (NuFileName) delete NuFileName;
     }
+
+    void JNuBeamFlux::RestoreStrings() {
+        if (!NuFileName) NuFileName = newObjString(NuFileNameId);
+    }
 }
\ No newline at end of file
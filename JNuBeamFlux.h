@@ -5,6 +5,7 @@ class JNuBeamFlux;
 } // end of namespace.
 #include "RooTrackerVtxBase.h"
 #include "TObjString.h"
+#include "StringPool.h"
 namespace ND {
 class JNuBeamFlux : public ND::RooTrackerVtxBase {
 public:
@@ -54,9 +55,15 @@ public:
    float       NuAlpha[2];          ///< Beam Alpha 
    float       NuHcur[3];           ///< Horn currents 
    int         NuRand;              ///< Random seed
+   StringHandle NuFileNameId;       //! NuFileName in the StringPool, set while streaming (not written)
    JNuBeamFlux();
    JNuBeamFlux(const JNuBeamFlux & );
+   JNuBeamFlux(JNuBeamFlux && );
    virtual ~JNuBeamFlux();
+   // Create NuFileName from its handle before writing a copy
+   void RestoreStrings();
+private:
+   void CopyFixedArrays(const JNuBeamFlux& other);
    ClassDef(JNuBeamFlux,2); // Generated by MakeProject.
 };
 } // namespace
@@ -7,4 +7,25 @@
 #pragma link C++ class ND::RooTrackerVtxBase+;
 #pragma link C++ class ND::JNuBeamFlux+;
 #pragma link C++ class ND::NRooTrackerVtx+;
+
+// Intern the string members while they are streamed in, so the handles are
+// set once per GetEntry() and copies only need to carry them
+#pragma read sourceClass="ND::JNuBeamFlux" targetClass="ND::JNuBeamFlux" version="[1-]" \
+    source="TObjString* NuFileName" target="NuFileNameId" include="StringPool.h" \
+    code="{ NuFileNameId = internObjString(onfile.NuFileName); }"
+#pragma read sourceClass="ND::NRooTrackerVtx" targetClass="ND::NRooTrackerVtx" version="[1-]" \
+    source="TObjString* EvtCode" target="EvtCodeId" include="StringPool.h" \
+    code="{ EvtCodeId = internObjString(onfile.EvtCode); }"
+#pragma read sourceClass="ND::NRooTrackerVtx" targetClass="ND::NRooTrackerVtx" version="[1-]" \
+    source="TObjString* GeomPath" target="GeomPathId" include="StringPool.h" \
+    code="{ GeomPathId = internObjString(onfile.GeomPath); }"
+#pragma read sourceClass="ND::NRooTrackerVtx" targetClass="ND::NRooTrackerVtx" version="[1-]" \
+    source="TObjString* GeneratorName" target="GeneratorNameId" include="StringPool.h" \
+    code="{ GeneratorNameId = internObjString(onfile.GeneratorName); }"
+#pragma read sourceClass="ND::NRooTrackerVtx" targetClass="ND::NRooTrackerVtx" version="[1-]" \
+    source="TObjString* OrigFileName" target="OrigFileNameId" include="StringPool.h" \
+    code="{ OrigFileNameId = internObjString(onfile.OrigFileName); }"
+#pragma read sourceClass="ND::NRooTrackerVtx" targetClass="ND::NRooTrackerVtx" version="[1-]" \
+    source="TObjString* OrigTreeName" target="OrigTreeNameId" include="StringPool.h" \
+    code="{ OrigTreeNameId = internObjString(onfile.OrigTreeName); }"
 #endif
\ No newline at end of file
@@ -1,6 +1,24 @@
 #include "NRooTrackerVtx.h"
+
+#include <utility>
+
 ClassImp(ND::NRooTrackerVtx)
 
+namespace {
+    // Copy of a variable length array. The source may be null with a non-zero
+    // count when its branch was not read (SetBranchStatus), and then so is
+    // the copy.
+    template <class T>
+    T* copyArray(const T* source, int n) {
+        if (!source || n <= 0) return nullptr;
+        T* copy = new T[n];
+        for (int i = 0; i < n; ++i) {
+            copy[i] = source[i];
+        }
+        return copy;
+    }
+}
+
 namespace ND {
     NRooTrackerVtx::NRooTrackerVtx() : JNuBeamFlux(),
         EvtCode(nullptr),
@@ -53,7 +71,12 @@ namespace ND {
         OrigTreeEntries(0),
         OrigTreePOT(0),
         TimeInSpill(0),
-        TruthVertexID(0)
+        TruthVertexID(0),
+        EvtCodeId(kNoString),
+        GeomPathId(kNoString),
+        GeneratorNameId(kNoString),
+        OrigFileNameId(kNoString),
+        OrigTreeNameId(kNoString)
     {
         // Initialize arrays
         for (int i = 0; i < 4; ++i) {
@@ -81,6 +104,7 @@ namespace ND {
     }
 
     NRooTrackerVtx::NRooTrackerVtx(const NRooTrackerVtx& other) : JNuBeamFlux(other),
+        EvtCode(nullptr),
         EvtNum(other.EvtNum),
         EvtXSec(other.EvtXSec),
         EvtDXSec(other.EvtDXSec),
@@ -122,43 +146,158 @@ namespace ND {
         NFfirststep(nullptr),
         NFnstep(other.NFnstep),
         NFecms2(nullptr),
+        GeomPath(nullptr),
+        GeneratorName(nullptr),
+        OrigFileName(nullptr),
+        OrigTreeName(nullptr),
         OrigEvtNum(other.OrigEvtNum),
         OrigTreeEntries(other.OrigTreeEntries),
         OrigTreePOT(other.OrigTreePOT),
         TimeInSpill(other.TimeInSpill),
-        TruthVertexID(other.TruthVertexID)
+        TruthVertexID(other.TruthVertexID),
+        EvtCodeId(other.EvtCodeId),
+        GeomPathId(other.GeomPathId),
+        GeneratorNameId(other.GeneratorNameId),
+        OrigFileNameId(other.OrigFileNameId),
+        OrigTreeNameId(other.OrigTreeNameId)
     {
-        // Deep copy for TObjString pointers
-        EvtCode = (other.EvtCode) ? (TObjString*)other.EvtCode->Clone() : nullptr;
-        GeomPath = (other.GeomPath) ? (TObjString*)other.GeomPath->Clone() : nullptr;
-        GeneratorName = (other.GeneratorName) ? (TObjString*)other.GeneratorName->Clone() : nullptr;
-        OrigFileName = (other.OrigFileName) ? (TObjString*)other.OrigFileName->Clone() : nullptr;
-        OrigTreeName = (other.OrigTreeName) ? (TObjString*)other.OrigTreeName->Clone() : nullptr;
+        // The copy only carries the pooled strings (see RestoreStrings())
+        CopyFixedArrays(other);
         
-        // Copy arrays
+        // Allocate and copy dynamic arrays
+        StdHepPdg = copyArray(other.StdHepPdg, StdHepN);
+        StdHepStatus = copyArray(other.StdHepStatus, StdHepN);
+        StdHepFd = copyArray(other.StdHepFd, StdHepN);
+        StdHepLd = copyArray(other.StdHepLd, StdHepN);
+        StdHepFm = copyArray(other.StdHepFm, StdHepN);
+        StdHepLm = copyArray(other.StdHepLm, StdHepN);
+        
+        // Allocate and copy NEnvc related arrays
+        NEipvc = copyArray(other.NEipvc, NEnvc);
+        NEiorgvc = copyArray(other.NEiorgvc, NEnvc);
+        NEiflgvc = copyArray(other.NEiflgvc, NEnvc);
+        NEicrnvc = copyArray(other.NEicrnvc, NEnvc);
+        
+        // Allocate and copy NEnvert related arrays
+        NEiflgvert = copyArray(other.NEiflgvert, NEnvert);
+        
+        // Allocate and copy NEnvcvert related arrays
+        NEabspvert = copyArray(other.NEabspvert, NEnvcvert);
+        NEabstpvert = copyArray(other.NEabstpvert, NEnvcvert);
+        NEipvert = copyArray(other.NEipvert, NEnvcvert);
+        NEiverti = copyArray(other.NEiverti, NEnvcvert);
+        NEivertf = copyArray(other.NEivertf, NEnvcvert);
+        
+        // Allocate and copy NFnvert related arrays
+        NFiflag = copyArray(other.NFiflag, NFnvert);
+        NFx = copyArray(other.NFx, NFnvert);
+        NFy = copyArray(other.NFy, NFnvert);
+        NFz = copyArray(other.NFz, NFnvert);
+        NFpx = copyArray(other.NFpx, NFnvert);
+        NFpy = copyArray(other.NFpy, NFnvert);
+        NFpz = copyArray(other.NFpz, NFnvert);
+        NFe = copyArray(other.NFe, NFnvert);
+        NFfirststep = copyArray(other.NFfirststep, NFnvert);
+        
+        // Allocate and copy NFnstep related arrays
+        NFecms2 = copyArray(other.NFecms2, NFnstep);
+    }
+
+    NRooTrackerVtx::NRooTrackerVtx(NRooTrackerVtx&& other) : JNuBeamFlux(std::move(other)),
+        EvtCode(nullptr),
+        EvtNum(other.EvtNum),
+        EvtXSec(other.EvtXSec),
+        EvtDXSec(other.EvtDXSec),
+        EvtWght(other.EvtWght),
+        EvtProb(other.EvtProb),
+        StdHepN(other.StdHepN),
+        StdHepPdg(other.StdHepPdg),
+        StdHepStatus(other.StdHepStatus),
+        StdHepFd(other.StdHepFd),
+        StdHepLd(other.StdHepLd),
+        StdHepFm(other.StdHepFm),
+        StdHepLm(other.StdHepLm),
+        NEnvc(other.NEnvc),
+        NEipvc(other.NEipvc),
+        NEiorgvc(other.NEiorgvc),
+        NEiflgvc(other.NEiflgvc),
+        NEicrnvc(other.NEicrnvc),
+        NEcrsx(other.NEcrsx),
+        NEcrsy(other.NEcrsy),
+        NEcrsz(other.NEcrsz),
+        NEcrsphi(other.NEcrsphi),
+        NEnvert(other.NEnvert),
+        NEiflgvert(other.NEiflgvert),
+        NEnvcvert(other.NEnvcvert),
+        NEabspvert(other.NEabspvert),
+        NEabstpvert(other.NEabstpvert),
+        NEipvert(other.NEipvert),
+        NEiverti(other.NEiverti),
+        NEivertf(other.NEivertf),
+        NFnvert(other.NFnvert),
+        NFiflag(other.NFiflag),
+        NFx(other.NFx),
+        NFy(other.NFy),
+        NFz(other.NFz),
+        NFpx(other.NFpx),
+        NFpy(other.NFpy),
+        NFpz(other.NFpz),
+        NFe(other.NFe),
+        NFfirststep(other.NFfirststep),
+        NFnstep(other.NFnstep),
+        NFecms2(other.NFecms2),
+        GeomPath(nullptr),
+        GeneratorName(nullptr),
+        OrigFileName(nullptr),
+        OrigTreeName(nullptr),
+        OrigEvtNum(other.OrigEvtNum),
+        OrigTreeEntries(other.OrigTreeEntries),
+        OrigTreePOT(other.OrigTreePOT),
+        TimeInSpill(other.TimeInSpill),
+        TruthVertexID(other.TruthVertexID),
+        EvtCodeId(other.EvtCodeId),
+        GeomPathId(other.GeomPathId),
+        GeneratorNameId(other.GeneratorNameId),
+        OrigFileNameId(other.OrigFileNameId),
+        OrigTreeNameId(other.OrigTreeNameId)
+    {
+        // Take over the variable length arrays of the original. Its
+        // TObjStrings stay, so a read buffer keeps them for the next entry.
+        other.StdHepPdg = nullptr;
+        other.StdHepStatus = nullptr;
+        other.StdHepFd = nullptr;
+        other.StdHepLd = nullptr;
+        other.StdHepFm = nullptr;
+        other.StdHepLm = nullptr;
+        other.NEipvc = nullptr;
+        other.NEiorgvc = nullptr;
+        other.NEiflgvc = nullptr;
+        other.NEicrnvc = nullptr;
+        other.NEiflgvert = nullptr;
+        other.NEabspvert = nullptr;
+        other.NEabstpvert = nullptr;
+        other.NEipvert = nullptr;
+        other.NEiverti = nullptr;
+        other.NEivertf = nullptr;
+        other.NFiflag = nullptr;
+        other.NFx = nullptr;
+        other.NFy = nullptr;
+        other.NFz = nullptr;
+        other.NFpx = nullptr;
+        other.NFpy = nullptr;
+        other.NFpz = nullptr;
+        other.NFe = nullptr;
+        other.NFfirststep = nullptr;
+        other.NFecms2 = nullptr;
+        
+        CopyFixedArrays(other);
+    }
+
+    void NRooTrackerVtx::CopyFixedArrays(const NRooTrackerVtx& other) {
         for (int i = 0; i < 4; ++i) {
             EvtVtx[i] = other.EvtVtx[i];
         }
         
-        // Allocate and copy dynamic arrays
-        if (StdHepN > 0) {
-            StdHepPdg = new Int_t[StdHepN];
-            StdHepStatus = new Int_t[StdHepN];
-            StdHepFd = new Int_t[StdHepN];
-            StdHepLd = new Int_t[StdHepN];
-            StdHepFm = new Int_t[StdHepN];
-            StdHepLm = new Int_t[StdHepN];
-            
-            for (int i = 0; i < StdHepN; ++i) {
-                StdHepPdg[i] = other.StdHepPdg[i];
-                StdHepStatus[i] = other.StdHepStatus[i];
-                StdHepFd[i] = other.StdHepFd[i];
-                StdHepLd[i] = other.StdHepLd[i];
-                StdHepFm[i] = other.StdHepFm[i];
-                StdHepLm[i] = other.StdHepLm[i];
-            }
-        }
-        
         // Copy StdHepX4, StdHepP4, StdHepPolz fixed arrays
         for (int i = 0; i < 100; ++i) {
             for (int j = 0; j < 4; ++j) {
@@ -173,87 +312,12 @@ namespace ND {
             }
         }
         
-        // Allocate and copy NEnvc related arrays
-        if (NEnvc > 0) {
-            NEipvc = new Int_t[NEnvc];
-            NEiorgvc = new Int_t[NEnvc];
-            NEiflgvc = new Int_t[NEnvc];
-            NEicrnvc = new Int_t[NEnvc];
-            
-            for (int i = 0; i < NEnvc; ++i) {
-                NEipvc[i] = other.NEipvc[i];
-                NEiorgvc[i] = other.NEiorgvc[i];
-                NEiflgvc[i] = other.NEiflgvc[i];
-                NEicrnvc[i] = other.NEicrnvc[i];
-            }
-        }
-        
-        // Allocate and copy NEnvert related arrays
-        if (NEnvert > 0) {
-            NEiflgvert = new Int_t[NEnvert];
-            
-            for (int i = 0; i < NEnvert; ++i) {
-                NEiflgvert[i] = other.NEiflgvert[i];
-            }
-        }
-        
         // Copy NEdirvert fixed array
         for (int i = 0; i < 300; ++i) {
             for (int j = 0; j < 3; ++j) {
                 NEdirvert[i][j] = other.NEdirvert[i][j];
             }
         }
-        
-        // Allocate and copy NEnvcvert related arrays
-        if (NEnvcvert > 0) {
-            NEabspvert = new Float_t[NEnvcvert];
-            NEabstpvert = new Float_t[NEnvcvert];
-            NEipvert = new Int_t[NEnvcvert];
-            NEiverti = new Int_t[NEnvcvert];
-            NEivertf = new Int_t[NEnvcvert];
-            
-            for (int i = 0; i < NEnvcvert; ++i) {
-                NEabspvert[i] = other.NEabspvert[i];
-                NEabstpvert[i] = other.NEabstpvert[i];
-                NEipvert[i] = other.NEipvert[i];
-                NEiverti[i] = other.NEiverti[i];
-                NEivertf[i] = other.NEivertf[i];
-            }
-        }
-        
-        // Allocate and copy NFnvert related arrays
-        if (NFnvert > 0) {
-            NFiflag = new Int_t[NFnvert];
-            NFx = new Float_t[NFnvert];
-            NFy = new Float_t[NFnvert];
-            NFz = new Float_t[NFnvert];
-            NFpx = new Float_t[NFnvert];
-            NFpy = new Float_t[NFnvert];
-            NFpz = new Float_t[NFnvert];
-            NFe = new Float_t[NFnvert];
-            NFfirststep = new Int_t[NFnvert];
-            
-            for (int i = 0; i < NFnvert; ++i) {
-                NFiflag[i] = other.NFiflag[i];
-                NFx[i] = other.NFx[i];
-                NFy[i] = other.NFy[i];
-                NFz[i] = other.NFz[i];
-                NFpx[i] = other.NFpx[i];
-                NFpy[i] = other.NFpy[i];
-                NFpz[i] = other.NFpz[i];
-                NFe[i] = other.NFe[i];
-                NFfirststep[i] = other.NFfirststep[i];
-            }
-        }
-        
-        // Allocate and copy NFnstep related arrays
-        if (NFnstep > 0) {
-            NFecms2 = new Float_t[NFnstep];
-            
-            for (int i = 0; i < NFnstep; ++i) {
-                NFecms2[i] = other.NFecms2[i];
-            }
-        }
     }
 
     NRooTrackerVtx::~NRooTrackerVtx() {
@@ -292,4 +356,13 @@ namespace ND {
         delete[] NFfirststep;
         delete[] NFecms2;
     }
+
+    void NRooTrackerVtx::RestoreStrings() {
+        JNuBeamFlux::RestoreStrings();
+        if (!EvtCode) EvtCode = newObjString(EvtCodeId);
+        if (!GeomPath) GeomPath = newObjString(GeomPathId);
+        if (!GeneratorName) GeneratorName = newObjString(GeneratorNameId);
+        if (!OrigFileName) OrigFileName = newObjString(OrigFileNameId);
+        if (!OrigTreeName) OrigTreeName = newObjString(OrigTreeNameId);
+    }
 }
\ No newline at end of file
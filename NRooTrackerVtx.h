@@ -69,9 +69,26 @@ public:
    double      OrigTreePOT;  //
    double      TimeInSpill;  //
    int         TruthVertexID; //
+   // StringPool handles of the TObjString members (not written). They are
+   // set while the members are streamed in (see the read rules in
+   // LinkDef.h) and are the only strings a copy carries.
+   StringHandle EvtCodeId;       //!
+   StringHandle GeomPathId;      //!
+   StringHandle GeneratorNameId; //!
+   StringHandle OrigFileNameId;  //!
+   StringHandle OrigTreeNameId;  //!
    NRooTrackerVtx();
+   // Copies carry the string handles and no TObjString
    NRooTrackerVtx(const NRooTrackerVtx & );
+   // Takes over the variable length arrays of the original, which is left
+   // without them. Its TObjStrings stay with the original.
+   NRooTrackerVtx(NRooTrackerVtx && );
    virtual ~NRooTrackerVtx();
+   // Create the TObjString members from the handles, including the
+   // JNuBeamFlux one, before writing a copy
+   void RestoreStrings();
+private:
+   void CopyFixedArrays(const NRooTrackerVtx& other);
    ClassDef(NRooTrackerVtx,2); // Generated by MakeProject.
 };
 } // namespace
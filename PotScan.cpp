@@ -0,0 +1,398 @@
+#include "PotScan.h"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TClonesArray.h"
+#include "TROOT.h"
+
+#include "NRooTrackerVtx.h"
+#include "VtxSchema.h"
+
+namespace {
+    const char* kCacheFormat = "NRooTrackerVtx-pot-v2";
+    const char* kCacheEnd = "end";
+
+    // Members the scan reads
+    const char* POT_MEMBERS[] = {
+        "OrigFileName", "GeneratorName", "OrigTreePOT", "OrigTreeEntries"
+    };
+
+    // Columns read for every entry
+    const char* POT_BRANCHES[] = {
+        "NVtx",
+        "Vtx.OrigFileName*"
+    };
+
+    // Columns that only matter when OrigFileName changes. They stay disabled
+    // and are read branch by branch for the entries that need them.
+    const char* POT_DETAIL_BRANCHES[] = {
+        "Vtx.GeneratorName",
+        "Vtx.OrigTreePOT",
+        "Vtx.OrigTreeEntries"
+    };
+    const size_t kNDetailBranches = sizeof(POT_DETAIL_BRANCHES) / sizeof(POT_DETAIL_BRANCHES[0]);
+
+    // Cache fields are tab separated, one source per line, so tabs, newlines
+    // and backslashes in names are escaped
+    std::string escapeField(const std::string& field) {
+        std::string escaped;
+        escaped.reserve(field.size());
+        for (size_t i = 0; i < field.size(); ++i) {
+            char c = field[i];
+            if (c == '\\') escaped += "\\\\";
+            else if (c == '\t') escaped += "\\t";
+            else if (c == '\n') escaped += "\\n";
+            else if (c == '\r') escaped += "\\r";
+            else escaped += c;
+        }
+        return escaped;
+    }
+
+    bool unescapeField(const std::string& field, std::string& result) {
+        result.clear();
+        result.reserve(field.size());
+        for (size_t i = 0; i < field.size(); ++i) {
+            char c = field[i];
+            if (c != '\\') {
+                result += c;
+                continue;
+            }
+            if (++i == field.size()) return false;
+            switch (field[i]) {
+                case '\\': result += '\\'; break;
+                case 't': result += '\t'; break;
+                case 'n': result += '\n'; break;
+                case 'r': result += '\r'; break;
+                default: return false;
+            }
+        }
+        return true;
+    }
+
+    void mergeSource(PotSource& into, const PotSource& source) {
+        if (into.nVertices == 0) {
+            into = source;
+            return;
+        }
+        if (into.generator != source.generator || into.pot != source.pot || into.origEntries != source.origEntries) {
+            into.inconsistent = true;
+        }
+        into.inconsistent = into.inconsistent || source.inconsistent;
+        into.nVertices += source.nVertices;
+    }
+}
+
+double FilePot::GetPot() const {
+    double pot = 0;
+    for (std::map<std::string, PotSource>::const_iterator it = sources.begin(); it != sources.end(); ++it) {
+        pot += it->second.pot;
+    }
+    return pot;
+}
+
+bool scanFilePot(const std::string& filename, FilePot& result) {
+    TFile* file = TFile::Open(filename.c_str(), "READ");
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+    TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+    if (!nuTree) {
+        std::cerr << "Tree 'NRooTrackerVtx' not found in file " << filename << std::endl;
+        file->Close();
+        delete file;
+        return false;
+    }
+    result.identity.nEntries = nuTree->GetEntries();
+
+    VtxSchema schema;
+    bool hasMembers = readVtxSchema(file, schema);
+    for (size_t m = 0; hasMembers && m < sizeof(POT_MEMBERS) / sizeof(POT_MEMBERS[0]); ++m) {
+        hasMembers = schema.Has(POT_MEMBERS[m]);
+    }
+    if (!hasMembers) {
+        std::cerr << "File " << filename << " has no OrigFileName, GeneratorName, OrigTreePOT or OrigTreeEntries" << std::endl;
+        file->Close();
+        delete file;
+        return false;
+    }
+
+    nuTree->SetBranchStatus("*", 0);
+    for (size_t b = 0; b < sizeof(POT_BRANCHES) / sizeof(POT_BRANCHES[0]); ++b) {
+        nuTree->SetBranchStatus(POT_BRANCHES[b], 1);
+    }
+
+    TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+    int NRooVtx = 0;
+    nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+    nuTree->SetBranchAddress("NVtx", &NRooVtx);
+
+    TBranch* detailBranches[kNDetailBranches];
+    for (size_t b = 0; b < kNDetailBranches; ++b) {
+        detailBranches[b] = nuTree->GetBranch(POT_DETAIL_BRANCHES[b]);
+        if (!detailBranches[b]) {
+            std::cerr << "Branch " << POT_DETAIL_BRANCHES[b] << " not found in file " << filename << std::endl;
+            nuTree->ResetBranchAddresses();
+            delete nRooVtxs;
+            file->Close();
+            delete file;
+            return false;
+        }
+    }
+
+    // Vertices of one source are normally stored next to each other, so the
+    // source of the previous vertex is remembered. The generator, POT and
+    // entries are only read where the source changes and are checked against
+    // the other runs of vertices of the same source.
+    StringPool& pool = StringPool::Instance();
+    StringHandle currentName = kNoString;
+    PotSource* current = nullptr;
+
+    for (Long64_t entry = 0; entry < result.identity.nEntries; ++entry) {
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+        bool detailsRead = false;
+
+        for (int i = 0; i < NRooVtx; ++i) {
+            ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+            if (!vtx) continue;
+            result.nVertices++;
+
+            StringHandle name = vtx->OrigFileNameId;
+            if (current && name == currentName) {
+                current->nVertices++;
+                continue;
+            }
+            currentName = name;
+            current = &result.sources[pool.Get(currentName)];
+
+            // getall = 1 reads the disabled branches
+            if (!detailsRead) {
+                for (size_t b = 0; b < kNDetailBranches; ++b) {
+                    detailBranches[b]->GetEntry(entry, 1);
+                }
+                detailsRead = true;
+            }
+            PotSource source;
+            source.generator = pool.Get(vtx->GeneratorNameId);
+            source.pot = vtx->OrigTreePOT;
+            source.origEntries = vtx->OrigTreeEntries;
+            source.nVertices = 1;
+            mergeSource(*current, source);
+        }
+    }
+
+    nuTree->ResetBranchAddresses();
+    delete nRooVtxs;
+    file->Close();
+    delete file;
+    return true;
+}
+
+bool readPotCache(const std::string& cacheDir, const FileIdentity& identity, FilePot& result) {
+    std::ifstream in(fileCachePath(cacheDir, identity.path, ".pot").c_str());
+    if (!in) return false;
+
+    std::string line;
+    if (!std::getline(in, line) || line != kCacheFormat) return false;
+
+    // The scanned range covers the whole file
+    WorkUnit scanned;
+    if (!std::getline(in, line) || !parseWorkUnit(line, scanned)) return false;
+    if (scanned.file.path != identity.path || scanned.file.size != identity.size ||
+        scanned.file.mtime != identity.mtime) {
+        return false;
+    }
+
+    FilePot cached;
+    cached.identity = scanned.file;
+    cached.fromCache = true;
+    if (!(in >> cached.nVertices) || !std::getline(in, line)) return false;
+
+    // One source per line:
+    //   <pot>\t<origEntries>\t<nVertices>\t<inconsistent>\t<generator>\t<OrigFileName>
+    bool complete = false;
+    while (std::getline(in, line)) {
+        if (line == kCacheEnd) {
+            complete = true;
+            break;
+        }
+        std::istringstream fields(line);
+        PotSource source;
+        std::string generator, name;
+        if (!(fields >> source.pot >> source.origEntries >> source.nVertices >> source.inconsistent)) return false;
+        fields.get();
+        if (!std::getline(fields, generator, '\t')) return false;
+        std::getline(fields, name);
+        if (!unescapeField(generator, source.generator)) return false;
+        std::string unescapedName;
+        if (!unescapeField(name, unescapedName)) return false;
+        cached.sources[unescapedName] = source;
+    }
+    if (!complete) return false;
+
+    result = cached;
+    return true;
+}
+
+bool writePotCache(const std::string& cacheDir, const FilePot& result) {
+    if (!makeDirectories(cacheDir)) {
+        std::cerr << "Cannot create POT cache directory: " << cacheDir << std::endl;
+        return false;
+    }
+
+    std::string path = fileCachePath(cacheDir, result.identity.path, ".pot");
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath.c_str());
+    if (!out) {
+        std::cerr << "Cannot write POT cache: " << tmpPath << std::endl;
+        return false;
+    }
+
+    WorkUnit scanned;
+    scanned.file = result.identity;
+    scanned.end = result.identity.nEntries;
+    out << kCacheFormat << "\n" << formatWorkUnit(scanned) << "\n" << result.nVertices << "\n";
+    out << std::setprecision(17);
+    for (std::map<std::string, PotSource>::const_iterator it = result.sources.begin(); it != result.sources.end(); ++it) {
+        const PotSource& source = it->second;
+        out << source.pot << '\t' << source.origEntries << '\t' << source.nVertices << '\t'
+            << source.inconsistent << '\t' << escapeField(source.generator) << '\t' << escapeField(it->first) << "\n";
+    }
+    out << kCacheEnd << "\n";
+    out.close();
+
+    if (!out || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot write POT cache: " << path << std::endl;
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string defaultPotCacheDir() {
+    return defaultCacheDir("pot");
+}
+
+bool scanPotFiles(const std::vector<std::string>& filenames, int nThreads,
+                  const std::string& cacheDir, std::vector<FilePot>& results) {
+    results.assign(filenames.size(), FilePot());
+    std::vector<char> ok(filenames.size(), 0);
+    std::atomic<size_t> next(0);
+
+    // Each thread takes the next unscanned file and opens it on its own
+    auto worker = [&]() {
+        size_t f;
+        while ((f = next++) < filenames.size()) {
+            FilePot& result = results[f];
+            if (!statFileIdentity(filenames[f], result.identity)) {
+                std::cerr << "Cannot access file: " << filenames[f] << std::endl;
+                continue;
+            }
+            if (!cacheDir.empty() && readPotCache(cacheDir, result.identity, result)) {
+                ok[f] = 1;
+                continue;
+            }
+            if (!scanFilePot(filenames[f], result)) continue;
+            ok[f] = 1;
+            if (!cacheDir.empty()) writePotCache(cacheDir, result);
+        }
+    };
+
+    if (nThreads > (int)filenames.size()) nThreads = (int)filenames.size();
+    if (nThreads > 1) {
+        ROOT::EnableThreadSafety();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nThreads; ++t) {
+            threads.push_back(std::thread(worker));
+        }
+        for (size_t t = 0; t < threads.size(); ++t) {
+            threads[t].join();
+        }
+    } else {
+        worker();
+    }
+
+    for (size_t f = 0; f < ok.size(); ++f) {
+        if (!ok[f]) return false;
+    }
+    return true;
+}
+
+void printPotReport(std::ostream& out, const std::vector<FilePot>& results, bool listSources) {
+    out << "\n===== POT PER FILE =====\n";
+    out << std::left << std::setw(60) << "File" << std::right
+        << std::setw(12) << "Entries" << std::setw(12) << "Vertices"
+        << std::setw(10) << "Sources" << std::setw(16) << "POT" << "  Cached" << std::endl;
+
+    std::map<std::string, PotSource> total;
+    std::map<std::string, int> nFilesPerSource;
+    Long64_t nEntries = 0, nVertices = 0, nCached = 0;
+
+    for (size_t f = 0; f < results.size(); ++f) {
+        const FilePot& result = results[f];
+        out << std::left << std::setw(60) << result.identity.path << std::right
+            << std::setw(12) << result.identity.nEntries << std::setw(12) << result.nVertices
+            << std::setw(10) << result.sources.size() << std::setw(16) << result.GetPot()
+            << "  " << (result.fromCache ? "yes" : "no") << std::endl;
+
+        nEntries += result.identity.nEntries;
+        nVertices += result.nVertices;
+        if (result.fromCache) nCached++;
+        for (std::map<std::string, PotSource>::const_iterator it = result.sources.begin(); it != result.sources.end(); ++it) {
+            mergeSource(total[it->first], it->second);
+            nFilesPerSource[it->first]++;
+        }
+    }
+
+    // Every source counts once, however many input files it is spread over
+    std::map<std::string, double> potPerGenerator;
+    std::map<std::string, int> sourcesPerGenerator;
+    double totalPot = 0;
+    int nShared = 0, nInconsistent = 0;
+    for (std::map<std::string, PotSource>::const_iterator it = total.begin(); it != total.end(); ++it) {
+        totalPot += it->second.pot;
+        potPerGenerator[it->second.generator] += it->second.pot;
+        sourcesPerGenerator[it->second.generator]++;
+        if (nFilesPerSource[it->first] > 1) nShared++;
+        if (it->second.inconsistent) nInconsistent++;
+    }
+
+    out << "\n===== TOTAL =====\n";
+    out << "Files: " << results.size() << " (" << nCached << " from cache)" << std::endl;
+    out << "Entries: " << nEntries << ", vertices: " << nVertices << std::endl;
+    out << "Distinct original files (OrigFileName): " << total.size() << std::endl;
+    out << "Total POT: " << totalPot << std::endl;
+
+    out << "\n----- POT PER GENERATOR -----\n";
+    for (std::map<std::string, double>::const_iterator it = potPerGenerator.begin(); it != potPerGenerator.end(); ++it) {
+        out << std::left << std::setw(30) << (it->first.empty() ? "(none)" : it->first) << std::right
+            << std::setw(10) << sourcesPerGenerator[it->first] << " files" << std::setw(16) << it->second << " POT" << std::endl;
+    }
+
+    if (nShared > 0) {
+        out << "\n" << nShared << " original files are split over several input files; their POT is counted once" << std::endl;
+    }
+    if (nInconsistent > 0) {
+        out << "WARNING: " << nInconsistent << " original files have vertices that disagree on "
+            << "GeneratorName, OrigTreePOT or OrigTreeEntries; the first value seen is used" << std::endl;
+    }
+
+    if (listSources) {
+        out << "\n----- ORIGINAL FILES -----\n";
+        for (std::map<std::string, PotSource>::const_iterator it = total.begin(); it != total.end(); ++it) {
+            const PotSource& source = it->second;
+            out << (it->first.empty() ? "(none)" : it->first) << "  generator=" << source.generator
+                << " POT=" << source.pot << " entries=" << source.origEntries
+                << " vertices=" << source.nVertices << (source.inconsistent ? " INCONSISTENT" : "") << std::endl;
+        }
+    }
+}
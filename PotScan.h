@@ -0,0 +1,61 @@
+#ifndef PotScan_h
+#define PotScan_h
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Rtypes.h"
+#include "WorkUnit.h"
+
+// Exposure of one original generator file (OrigFileName), as recorded in
+// every vertex generated from it
+struct PotSource {
+    std::string generator;   // GeneratorName
+    double pot;              // OrigTreePOT
+    Long64_t origEntries;    // OrigTreeEntries
+    Long64_t nVertices;      // vertices from this source that were scanned
+    bool inconsistent;       // runs of vertices disagreed on generator, POT or entries
+
+    PotSource() : pot(0), origEntries(0), nVertices(0), inconsistent(false) {}
+};
+
+// Metadata of one input file: its sources keyed by OrigFileName
+struct FilePot {
+    FileIdentity identity;
+    Long64_t nVertices;
+    std::map<std::string, PotSource> sources;
+    bool fromCache;
+
+    FilePot() : nVertices(0), fromCache(false) {}
+
+    // Sum of the POT of the sources of this file
+    double GetPot() const;
+};
+
+// Read only the provenance members (OrigFileName, OrigTreePOT,
+// OrigTreeEntries, GeneratorName) of every vertex of a file. A source is
+// looked up again only where OrigFileName changes from one vertex to the next.
+bool scanFilePot(const std::string& filename, FilePot& result);
+
+// Per input file cache of scan results in 'cacheDir', one file per input
+// named after a hash of its canonical path. A cached result is used only if
+// the size and modification time of the input are unchanged.
+bool readPotCache(const std::string& cacheDir, const FileIdentity& identity, FilePot& result);
+bool writePotCache(const std::string& cacheDir, const FilePot& result);
+
+// Default cache directory: $XDG_CACHE_HOME/root_reader/pot, falling back to
+// $HOME/.cache/root_reader/pot. Empty if neither variable is set.
+std::string defaultPotCacheDir();
+
+// Scan files on 'nThreads' threads, using and filling the cache unless
+// 'cacheDir' is empty. 'results' is in the order of 'filenames'.
+bool scanPotFiles(const std::vector<std::string>& filenames, int nThreads,
+                  const std::string& cacheDir, std::vector<FilePot>& results);
+
+// Per-file table followed by the totals. Sources found in several input
+// files are counted once in the totals.
+void printPotReport(std::ostream& out, const std::vector<FilePot>& results, bool listSources);
+
+#endif
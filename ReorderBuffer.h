@@ -0,0 +1,84 @@
+#ifndef ReorderBuffer_h
+#define ReorderBuffer_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+
+// Hands results produced out of order by several threads to one consumer in
+// sequence order (0, 1, 2, ...).
+//
+// Producers Put() the result of sequence number s; the consumer Take()s them
+// in order. Put() blocks while s is 'capacity' or more ahead of the next
+// sequence number to be taken, so a slow item holds back the producers that
+// are ahead of it instead of letting finished results pile up: at most
+// 'capacity' results are buffered, plus one per blocked producer. The item
+// the consumer waits for is always below the limit, so this cannot deadlock
+// as long as every sequence number is eventually put (or Abort() is called).
+template <class T>
+class ReorderBuffer {
+public:
+    explicit ReorderBuffer(size_t capacity) :
+        capacity(capacity > 0 ? capacity : 1), next(0), end(0), closed(false), aborted(false) {}
+
+    // Store the result of 'sequence'. Returns false if the buffer was aborted.
+    bool Put(size_t sequence, T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!aborted && sequence >= next + capacity) {
+            notFull.wait(lock);
+        }
+        if (aborted) return false;
+        items.insert(std::make_pair(sequence, std::move(item)));
+        if (sequence == next) ready.notify_one();
+        return true;
+    }
+
+    // No sequence number from 'count' on will be put
+    void Close(size_t count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        end = count;
+        closed = true;
+        ready.notify_one();
+    }
+
+    // Stop all waiting: Put() and Take() return false from now on
+    void Abort() {
+        std::lock_guard<std::mutex> lock(mutex);
+        aborted = true;
+        ready.notify_all();
+        notFull.notify_all();
+    }
+
+    // The result of the next sequence number, waiting until it is put.
+    // Returns false once all results up to Close() were taken, or on Abort().
+    bool Take(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!aborted && !(closed && next >= end) && (items.empty() || items.begin()->first != next)) {
+            ready.wait(lock);
+        }
+        if (aborted || items.empty() || items.begin()->first != next) return false;
+        item = std::move(items.begin()->second);
+        items.erase(items.begin());
+        next++;
+        notFull.notify_all();
+        return true;
+    }
+
+private:
+    ReorderBuffer(const ReorderBuffer&);
+    ReorderBuffer& operator=(const ReorderBuffer&);
+
+    const size_t capacity;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::condition_variable notFull;
+    std::map<size_t, T> items;
+    size_t next;   // next sequence number to take
+    size_t end;    // number of sequence numbers, once closed
+    bool closed;
+    bool aborted;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "Sampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <set>
+#include <string>
+
+#include "NRooTrackerVtx.h"
+
+ULong64_t uniformBelow(SampleRng& rng, ULong64_t n) {
+    // Rejection sampling avoids the modulo bias
+    const ULong64_t max = std::numeric_limits<ULong64_t>::max();
+    ULong64_t limit = max - max % n;
+    ULong64_t x;
+    do {
+        x = rng();
+    } while (x >= limit);
+    return x % n;
+}
+
+std::vector<ULong64_t> chooseWithoutReplacement(SampleRng& rng, ULong64_t n, ULong64_t k) {
+    if (k > n) k = n;
+
+    // Floyd's algorithm: k draws, no O(n) storage
+    std::set<ULong64_t> chosen;
+    for (ULong64_t j = n - k; j < n; ++j) {
+        ULong64_t t = uniformBelow(rng, j + 1);
+        if (!chosen.insert(t).second) {
+            chosen.insert(j);
+        }
+    }
+    return std::vector<ULong64_t>(chosen.begin(), chosen.end());
+}
+
+EntryReservoir::EntryReservoir(ULong64_t size_, SampleRng& rng_) :
+    size(size_),
+    nSeen(0),
+    rng(rng_)
+{
+    items.reserve(size);
+}
+
+void EntryReservoir::Offer(int file, Long64_t entry) {
+    Item item;
+    item.file = file;
+    item.entry = entry;
+
+    if (items.size() < size) {
+        items.push_back(item);
+    } else if (size > 0) {
+        ULong64_t j = uniformBelow(rng, nSeen + 1);
+        if (j < size) items[j] = item;
+    }
+    nSeen++;
+}
+
+std::vector<EntryReservoir::Item> EntryReservoir::GetSorted() const {
+    std::vector<Item> sorted(items);
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+RatioEstimate::RatioEstimate() :
+    nUnits(0), sumY(0), sumN(0), sumYY(0), sumNN(0), sumYN(0)
+{
+}
+
+void RatioEstimate::Add(double y, double n) {
+    nUnits++;
+    sumY += y;
+    sumN += n;
+    sumYY += y * y;
+    sumNN += n * n;
+    sumYN += y * n;
+}
+
+double RatioEstimate::GetValue() const {
+    return sumN > 0 ? sumY / sumN : 0;
+}
+
+double RatioEstimate::GetError(double samplingFraction) const {
+    if (nUnits < 2 || sumN <= 0) return 0;
+    double r = GetValue();
+    // sum over units of (y - r n)^2
+    double residual = sumYY - 2 * r * sumYN + r * r * sumNN;
+    if (residual < 0) residual = 0;
+    double variance = (1 - samplingFraction) * nUnits / (nUnits - 1.0) * residual / (sumN * sumN);
+    return std::sqrt(variance);
+}
+
+const int SampleStats::FLAVOURS[SampleStats::kNFlavours] = {14, -14, 12, -12, 16, -16};
+
+SampleStats::SampleStats() :
+    nVertices(0),
+    unitEntries(0), unitVertices(0), unitWeight(0), unitReco(0),
+    unitNu(0), unitNuEnergy(0)
+{
+    for (int f = 0; f < kNFlavours; ++f) unitFlavour[f] = 0;
+}
+
+void SampleStats::BeginUnit() {
+    unitEntries = unitVertices = unitWeight = unitReco = 0;
+    unitNu = unitNuEnergy = 0;
+    for (int f = 0; f < kNFlavours; ++f) unitFlavour[f] = 0;
+}
+
+void SampleStats::AddEntry() {
+    unitEntries++;
+}
+
+void SampleStats::AddVertex(const ND::NRooTrackerVtx& vtx, bool reconstructed) {
+    nVertices++;
+    unitVertices++;
+    unitWeight += vtx.EvtWght;
+    if (reconstructed) unitReco++;
+
+    if (vtx.StdHepPdg == nullptr || vtx.StdHepStatus == nullptr) return;
+    for (int j = 0; j < vtx.StdHepN && j < 100; ++j) {
+        if (vtx.StdHepStatus[j] != 0) continue;
+        for (int f = 0; f < kNFlavours; ++f) {
+            if (vtx.StdHepPdg[j] == FLAVOURS[f]) {
+                unitNu++;
+                unitNuEnergy += vtx.StdHepP4[j][3];
+                unitFlavour[f]++;
+                return;
+            }
+        }
+    }
+}
+
+void SampleStats::EndUnit() {
+    verticesPerEntry.Add(unitVertices, unitEntries);
+    meanWeight.Add(unitWeight, unitVertices);
+    recoFraction.Add(unitReco, unitVertices);
+    meanNuEnergy.Add(unitNuEnergy, unitNu);
+    for (int f = 0; f < kNFlavours; ++f) {
+        flavourFraction[f].Add(unitFlavour[f], unitNu);
+    }
+}
+
+namespace {
+    void printEstimate(std::ostream& out, const std::string& label, const RatioEstimate& estimate,
+                       double samplingFraction, double scale = 1) {
+        out << std::left << std::setw(36) << label << std::right
+            << std::setw(14) << estimate.GetValue() * scale << " +- "
+            << estimate.GetError(samplingFraction) * scale << std::endl;
+    }
+}
+
+void SampleStats::Print(std::ostream& out, double samplingFraction, Long64_t totalEntries, bool hasRecoInfo) const {
+    out << "Sampled units: " << verticesPerEntry.GetNUnits()
+        << ", entries: " << (Long64_t)verticesPerEntry.GetSumN()
+        << ", vertices: " << nVertices << std::endl;
+    out << "Errors are one standard error estimated from the spread between sampled units\n" << std::endl;
+
+    printEstimate(out, "Vertices per entry", verticesPerEntry, samplingFraction);
+    printEstimate(out, "Estimated total vertices", verticesPerEntry, samplingFraction, (double)totalEntries);
+    printEstimate(out, "Mean event weight", meanWeight, samplingFraction);
+    if (hasRecoInfo) {
+        printEstimate(out, "Fraction with reconstruction", recoFraction, samplingFraction);
+    }
+    printEstimate(out, "Mean incoming nu energy (GeV)", meanNuEnergy, samplingFraction);
+
+    out << "\n----- INCOMING NEUTRINO FLAVOURS -----\n";
+    for (int f = 0; f < kNFlavours; ++f) {
+        if (flavourFraction[f].GetValue() == 0) continue;
+        std::string label = "PDG " + std::to_string(FLAVOURS[f]);
+        printEstimate(out, label, flavourFraction[f], samplingFraction);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef Sampling_h
+#define Sampling_h
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "Rtypes.h"
+
+namespace ND {
+class NRooTrackerVtx;
+}
+
+// Random selection helpers. All randomness comes from a seeded
+// std::mt19937_64 and our own bounded draws, so a given seed selects the same
+// sample with every compiler and standard library.
+typedef std::mt19937_64 SampleRng;
+
+// Uniform integer in [0, n)
+ULong64_t uniformBelow(SampleRng& rng, ULong64_t n);
+
+// Choose k distinct indices out of [0, n), returned in increasing order
+std::vector<ULong64_t> chooseWithoutReplacement(SampleRng& rng, ULong64_t n, ULong64_t k);
+
+// Reservoir sampling (algorithm R) over a stream of (file, entry) indices of
+// unknown total length. Only indices are streamed, no data is read.
+class EntryReservoir {
+public:
+    struct Item {
+        int file;
+        Long64_t entry;
+        bool operator<(const Item& other) const {
+            return file != other.file ? file < other.file : entry < other.entry;
+        }
+    };
+
+    EntryReservoir(ULong64_t size, SampleRng& rng);
+
+    void Offer(int file, Long64_t entry);
+
+    // The sample sorted by file and entry, for sequential reading
+    std::vector<Item> GetSorted() const;
+    ULong64_t GetNSeen() const { return nSeen; }
+
+private:
+    ULong64_t size;
+    ULong64_t nSeen;
+    SampleRng& rng;
+    std::vector<Item> items;
+};
+
+// Ratio estimate R = sum(y) / sum(n) from a sample of primary sampling units
+// (clusters or entries), each contributing a total y over n vertices. The
+// standard error uses the between-unit variance, so correlations between
+// vertices of the same unit are accounted for.
+class RatioEstimate {
+public:
+    RatioEstimate();
+
+    void Add(double y, double n);
+
+    double GetValue() const;
+    // 'samplingFraction' is the fraction of all units that was sampled and
+    // enters the finite population correction
+    double GetError(double samplingFraction) const;
+    Long64_t GetNUnits() const { return nUnits; }
+    double GetSumN() const { return sumN; }
+
+private:
+    Long64_t nUnits;
+    double sumY, sumN, sumYY, sumNN, sumYN;
+};
+
+// Statistics of a random sample of vertices
+class SampleStats {
+public:
+    SampleStats();
+
+    // Each sampled unit (cluster or entry) is opened with BeginUnit(), its
+    // entries and vertices are added, and it is closed with EndUnit()
+    void BeginUnit();
+    void AddEntry();
+    void AddVertex(const ND::NRooTrackerVtx& vtx, bool reconstructed);
+    void EndUnit();
+
+    // 'samplingFraction': fraction of the population units sampled,
+    // 'totalEntries': number of entries in all inputs
+    void Print(std::ostream& out, double samplingFraction, Long64_t totalEntries, bool hasRecoInfo) const;
+
+    Long64_t GetNVertices() const { return nVertices; }
+
+private:
+    static const int kNFlavours = 6;
+    static const int FLAVOURS[kNFlavours];
+
+    Long64_t nVertices;
+
+    // Per unit accumulators
+    double unitEntries, unitVertices, unitWeight, unitReco;
+    double unitNu, unitNuEnergy;
+    double unitFlavour[kNFlavours];
+
+    RatioEstimate verticesPerEntry;
+    RatioEstimate meanWeight;
+    RatioEstimate recoFraction;
+    RatioEstimate meanNuEnergy;
+    RatioEstimate flavourFraction[kNFlavours];
+};
+
+#endif
@@ -0,0 +1,225 @@
+#include "Sharding.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    const char* kPlanFormat = "NRooTrackerVtx-shard-plan-v1";
+    const char* kResultEnd = "end";
+
+    std::string planPath(const std::string& dir) {
+        return dir + "/plan.txt";
+    }
+
+    bool samePlan(const ShardPlan& a, const ShardPlan& b) {
+        if (a.configKey != b.configKey || a.shards.size() != b.shards.size()) return false;
+        for (size_t i = 0; i < a.shards.size(); ++i) {
+            if (formatWorkUnit(a.shards[i]) != formatWorkUnit(b.shards[i])) return false;
+        }
+        return true;
+    }
+
+    // Remove every shard result of 'dir', including ones of shards beyond the
+    // current plan and unfinished temporary files
+    bool removeShardResults(const std::string& dir) {
+        DIR* d = opendir(dir.c_str());
+        if (!d) {
+            std::cerr << "Cannot list shard directory " << dir << ": " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        bool ok = true;
+        while (struct dirent* e = readdir(d)) {
+            std::string name = e->d_name;
+            if (name.compare(0, 6, "shard-") != 0 || name.find(".result") == std::string::npos) continue;
+            std::string path = dir + "/" + name;
+            if (remove(path.c_str()) != 0) {
+                std::cerr << "Cannot remove stale shard result " << path << ": " << std::strerror(errno) << std::endl;
+                ok = false;
+            }
+        }
+        closedir(d);
+        return ok;
+    }
+}
+
+bool writeShardPlan(const std::string& dir, const ShardPlan& plan) {
+    std::string path = planPath(dir);
+    std::string tmpPath = path + ".tmp";
+
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "Cannot create shard directory " << dir << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Results of an earlier identical plan are kept so the workers can skip
+    // those shards. Any other results in the directory are stale.
+    std::ifstream existing(path.c_str());
+    bool keepResults = false;
+    if (existing) {
+        existing.close();
+        ShardPlan oldPlan;
+        keepResults = readShardPlan(dir, oldPlan) && samePlan(oldPlan, plan);
+        if (!keepResults) {
+            std::cout << "Shard plan in " << dir << " changed, discarding its results" << std::endl;
+        }
+    }
+    if (!keepResults && !removeShardResults(dir)) {
+        return false;
+    }
+
+    std::ofstream out(tmpPath.c_str());
+    if (!out) {
+        std::cerr << "Cannot write shard plan: " << tmpPath << std::endl;
+        return false;
+    }
+    out << kPlanFormat << " " << plan.configKey << "\n";
+    for (size_t i = 0; i < plan.shards.size(); ++i) {
+        out << formatWorkUnit(plan.shards[i]) << "\n";
+    }
+    out.close();
+    if (!out || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot write shard plan: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool readShardPlan(const std::string& dir, ShardPlan& plan) {
+    std::string path = planPath(dir);
+    std::ifstream in(path.c_str());
+    if (!in) {
+        std::cerr << "Cannot read shard plan: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::string prefix = std::string(kPlanFormat) + " ";
+    if (!std::getline(in, line) || line.compare(0, prefix.size(), prefix) != 0) {
+        std::cerr << "Not a shard plan: " << path << std::endl;
+        return false;
+    }
+
+    ShardPlan result;
+    result.configKey = line.substr(prefix.size());
+    while (std::getline(in, line)) {
+        WorkUnit unit;
+        if (!parseWorkUnit(line, unit)) {
+            std::cerr << "Malformed shard in " << path << ": " << line << std::endl;
+            return false;
+        }
+        result.shards.push_back(unit);
+    }
+
+    plan = result;
+    return true;
+}
+
+std::string shardResultPath(const std::string& dir, size_t shard) {
+    std::ostringstream path;
+    path << dir << "/shard-" << shard << ".result";
+    return path.str();
+}
+
+bool writeShardResult(const std::string& dir, size_t shard, const VtxSummary& summary) {
+    std::string path = shardResultPath(dir, shard);
+    std::string tmpPath = path + ".tmp";
+
+    std::ofstream out(tmpPath.c_str());
+    if (!out) {
+        std::cerr << "Cannot write shard result: " << tmpPath << std::endl;
+        return false;
+    }
+    summary.Write(out);
+    out << ' ' << kResultEnd << "\n";
+    out.close();
+
+    // The rename publishes the result only once it is complete
+    if (!out || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot write shard result: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool readShardResult(const std::string& dir, size_t shard, VtxSummary& summary) {
+    std::ifstream in(shardResultPath(dir, shard).c_str());
+    std::string marker;
+    return in && summary.Read(in) && (in >> marker) && marker == kResultEnd;
+}
+
+bool runLocalWorkers(const std::string& executable, const std::string& dir, int nWorkers) {
+    std::vector<pid_t> pids;
+    bool ok = true;
+
+    std::ostringstream nRanksText;
+    nRanksText << nWorkers;
+    std::string nRanks = nRanksText.str();
+
+    std::cout.flush();
+    std::cerr.flush();
+
+    for (int rank = 0; rank < nWorkers; ++rank) {
+        std::ostringstream rankText;
+        rankText << rank;
+        std::string rankString = rankText.str();
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "Cannot start worker " << rank << std::endl;
+            ok = false;
+            break;
+        }
+        if (pid == 0) {
+            const char* args[] = {executable.c_str(), "--shard-worker", dir.c_str(),
+                                  rankString.c_str(), nRanks.c_str(), nullptr};
+            execv(executable.c_str(), (char* const*)args);
+            std::cerr << "Cannot execute worker " << executable << std::endl;
+            _exit(127);
+        }
+        pids.push_back(pid);
+    }
+
+    for (size_t i = 0; i < pids.size(); ++i) {
+        int status = 0;
+        if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "Worker " << i << " failed" << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool mergeShardResults(const std::string& dir, const ShardPlan& plan, VtxSummary& total) {
+    VtxSummary result;
+    for (size_t i = 0; i < plan.shards.size(); ++i) {
+        VtxSummary partial;
+        if (!readShardResult(dir, i, partial)) {
+            std::cerr << "Missing or incomplete result for shard " << i << ": "
+                      << shardResultPath(dir, i) << std::endl;
+            return false;
+        }
+        result.Merge(partial);
+    }
+    total = result;
+    return true;
+}
+
+void removeShardDirectory(const std::string& dir, const ShardPlan& plan) {
+    for (size_t i = 0; i < plan.shards.size(); ++i) {
+        std::string path = shardResultPath(dir, i);
+        remove(path.c_str());
+        remove((path + ".tmp").c_str());
+    }
+    remove(planPath(dir).c_str());
+    rmdir(dir.c_str());
+}
@@ -0,0 +1,48 @@
+#ifndef Sharding_h
+#define Sharding_h
+
+#include <string>
+#include <vector>
+
+#include "VtxSummary.h"
+#include "WorkUnit.h"
+
+// Multi-process execution of the summary mode.
+//
+// All communication goes through a shared directory so the same protocol
+// works for worker processes started by the local coordinator and for
+// workers started by an external launcher (batch system, mpirun, ...):
+//
+//   <dir>/plan.txt           written by the coordinator: configuration key
+//                            followed by one shard (WorkUnit) per line
+//   <dir>/shard-<i>.result   written by the worker owning shard i; created
+//                            under a temporary name and renamed when complete
+//
+// Worker <rank> of <nRanks> owns the shards with i % nRanks == rank. Results
+// are always merged in shard order, so the merged summary does not depend on
+// how many workers were used or in which order they finished.
+struct ShardPlan {
+    std::string configKey;
+    std::vector<WorkUnit> shards;
+};
+
+bool writeShardPlan(const std::string& dir, const ShardPlan& plan);
+bool readShardPlan(const std::string& dir, ShardPlan& plan);
+
+std::string shardResultPath(const std::string& dir, size_t shard);
+bool writeShardResult(const std::string& dir, size_t shard, const VtxSummary& summary);
+bool readShardResult(const std::string& dir, size_t shard, VtxSummary& summary);
+
+// Start 'nWorkers' copies of 'executable' as local worker processes, passing
+// "--shard-worker <dir> <rank> <nWorkers>", and wait for all of them.
+// Returns false if any worker could not be started or exited with an error.
+bool runLocalWorkers(const std::string& executable, const std::string& dir, int nWorkers);
+
+// Merge the results of all shards of 'plan' in shard order.
+// Fails if any shard result is missing or unreadable.
+bool mergeShardResults(const std::string& dir, const ShardPlan& plan, VtxSummary& total);
+
+// Remove the plan and result files and the directory itself
+void removeShardDirectory(const std::string& dir, const ShardPlan& plan);
+
+#endif
@@ -0,0 +1,472 @@
+#include "SkimWriter.h"
+
+#include <iostream>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TObjArray.h"
+#include "TBranchElement.h"
+#include "TBasket.h"
+#include "TLeaf.h"
+#include "TClonesArray.h"
+
+#include "NRooTrackerVtx.h"
+
+namespace {
+    // Entry by entry copy of 'entries' (all entries if null) of 'in' into
+    // 'out', through buffers shared between the two trees
+    void copyEntriesSlow(TTree* in, TTree* out, const std::vector<Long64_t>* entries) {
+        in->CopyAddresses(out);
+        Long64_t n = entries ? (Long64_t)entries->size() : in->GetEntries();
+        for (Long64_t i = 0; i < n; ++i) {
+            in->GetEntry(entries ? (*entries)[i] : i);
+            out->Fill();
+        }
+        in->CopyAddresses(out, kTRUE);
+    }
+
+    void applyBranchPatterns(TTree* tree, const std::vector<std::string>& patterns) {
+        if (patterns.empty()) return;
+        tree->SetBranchStatus("*", 0);
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            tree->SetBranchStatus(patterns[p].c_str(), 1);
+        }
+    }
+}
+
+SkimWriter::SkimWriter() :
+    outFile(nullptr),
+    outTree(nullptr),
+    outEvt(nullptr),
+    outVtxs(nullptr),
+    outNVtx(0),
+    rangeFile(nullptr),
+    rangeTree(nullptr),
+    rangeBaskets(false),
+    markedEntries(0),
+    finished(false),
+    failed(false),
+    nEntries(0),
+    nFastEntries(0),
+    nVertices(0),
+    nEvents(0)
+{
+}
+
+SkimWriter::~SkimWriter() {
+    if (outFile) Close();
+}
+
+bool SkimWriter::Open(const std::string& output, const std::string& templateInput,
+                      const std::vector<std::string>& branchPatterns) {
+    TFile* in = TFile::Open(templateInput.c_str(), "READ");
+    if (!in || in->IsZombie()) {
+        std::cerr << "Error opening file: " << templateInput << std::endl;
+        delete in;
+        return false;
+    }
+    TTree* inTree = (TTree*)in->Get("NRooTrackerVtx");
+    if (!inTree) {
+        std::cerr << "Tree 'NRooTrackerVtx' not found in file " << templateInput << std::endl;
+        in->Close();
+        delete in;
+        return false;
+    }
+
+    outFile = TFile::Open(output.c_str(), "RECREATE");
+    if (!outFile || outFile->IsZombie()) {
+        std::cerr << "Error creating file: " << output << std::endl;
+        delete outFile;
+        outFile = nullptr;
+        in->Close();
+        delete in;
+        return false;
+    }
+
+    // CloneTree() only clones the active branches, which is the projection.
+    // Basket sizes, compression and clustering come from the input, so
+    // unprojected clones can take basket-level copies of the inputs.
+    patterns = branchPatterns;
+    applyBranchPatterns(inTree, patterns);
+    outFile->cd();
+    outTree = inTree->CloneTree(0);
+
+    // Deleting the template detaches the clones from its buffers
+    in->Close();
+    delete in;
+
+    outVtxs = new TClonesArray("ND::NRooTrackerVtx");
+    AttachOutputBuffers();
+
+    writerThread = std::thread(&SkimWriter::WriterLoop, this);
+    return true;
+}
+
+void SkimWriter::AttachOutputBuffers() {
+    outTree->SetBranchAddress("Vtx", &outVtxs);
+    outTree->SetBranchAddress("NVtx", &outNVtx);
+}
+
+void SkimWriter::Push(std::unique_ptr<Item> item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (queue.size() >= kQueueCapacity) {
+        notFull.wait(lock);
+    }
+    queue.push_back(std::move(item));
+    notEmpty.notify_one();
+}
+
+void SkimWriter::CopyVertices(const std::string& input) {
+    std::unique_ptr<Item> item(new Item());
+    item->kind = Item::kCopyVertices;
+    item->input = input;
+    Push(std::move(item));
+}
+
+void SkimWriter::CopyVertexRange(const std::string& input, Long64_t first, Long64_t last) {
+    std::unique_ptr<Item> item(new Item());
+    item->kind = Item::kCopyRange;
+    item->input = input;
+    item->first = first;
+    item->last = last;
+    Push(std::move(item));
+}
+
+void SkimWriter::Write(std::unique_ptr<DecodedEntry> entry) {
+    std::unique_ptr<Item> item(new Item());
+    item->kind = Item::kEntry;
+    item->entry = std::move(entry);
+    Push(std::move(item));
+}
+
+void SkimWriter::CopyEvents(const std::string& input, const std::set<int>& eventIDs) {
+    std::unique_ptr<Item> item(new Item());
+    item->kind = Item::kCopyEvents;
+    item->input = input;
+    item->allEvents = false;
+    item->eventIDs = eventIDs;
+    Push(std::move(item));
+}
+
+void SkimWriter::CopyAllEvents(const std::string& input) {
+    std::unique_ptr<Item> item(new Item());
+    item->kind = Item::kCopyEvents;
+    item->input = input;
+    item->allEvents = true;
+    Push(std::move(item));
+}
+
+void SkimWriter::WriterLoop() {
+    while (true) {
+        std::unique_ptr<Item> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (queue.empty() && !finished) {
+                notEmpty.wait(lock);
+            }
+            if (queue.empty()) return;
+            item = std::move(queue.front());
+            queue.pop_front();
+            notFull.notify_one();
+        }
+
+        // After a failure the queue is only drained, so the caller never blocks
+        if (failed) continue;
+
+        bool ok = true;
+        if (item->kind == Item::kEntry) {
+            WriteEntry(*item->entry);
+        } else if (item->kind == Item::kCopyVertices) {
+            ok = CopyVerticesFrom(item->input);
+        } else if (item->kind == Item::kCopyRange) {
+            ok = CopyRangeFrom(item->input, item->first, item->last);
+        } else {
+            ok = CopyEventsFrom(item->input, item->allEvents, item->eventIDs);
+        }
+        if (!ok) failed = true;
+    }
+}
+
+void SkimWriter::WriteEntry(DecodedEntry& entry) {
+    // Delete() rather than Clear(): the vertices own arrays and strings
+    outVtxs->Delete();
+    int n = 0;
+    for (size_t i = 0; i < entry.vertices.size(); ++i) {
+        if (!entry.vertices[i]) continue;
+        // The entry is dropped after this, so its arrays are moved rather
+        // than copied a second time. Copies only carry pooled strings, which
+        // become TObjStrings again here.
+        ND::NRooTrackerVtx* vtx = new ((*outVtxs)[n++]) ND::NRooTrackerVtx(std::move(*entry.vertices[i]));
+        vtx->RestoreStrings();
+    }
+    outNVtx = n;
+    outTree->Fill();
+
+    nEntries++;
+    nVertices += n;
+}
+
+bool SkimWriter::CopyVerticesFrom(const std::string& input) {
+    TFile* in = TFile::Open(input.c_str(), "READ");
+    if (!in || in->IsZombie()) {
+        std::cerr << "Error opening file: " << input << std::endl;
+        delete in;
+        return false;
+    }
+    TTree* inTree = (TTree*)in->Get("NRooTrackerVtx");
+    if (!inTree) {
+        std::cerr << "Tree 'NRooTrackerVtx' not found in file " << input << std::endl;
+        in->Close();
+        delete in;
+        return false;
+    }
+
+    // Compressed baskets are copied as they are when the branch structure
+    // matches; a projection always needs the entry by entry copy
+    Long64_t n = inTree->GetEntries();
+    if (patterns.empty() && outTree->CopyEntries(inTree, -1, "fast") >= 0) {
+        nFastEntries += n;
+    } else {
+        applyBranchPatterns(inTree, patterns);
+        copyEntriesSlow(inTree, outTree, nullptr);
+    }
+    nEntries += n;
+    AttachOutputBuffers();
+
+    in->Close();
+    delete in;
+    return true;
+}
+
+bool SkimWriter::OpenRangeInput(const std::string& input) {
+    if (rangeFile && input == rangeInput) return true;
+    CloseRangeInput();
+
+    rangeFile = TFile::Open(input.c_str(), "READ");
+    if (!rangeFile || rangeFile->IsZombie()) {
+        std::cerr << "Error opening file: " << input << std::endl;
+        delete rangeFile;
+        rangeFile = nullptr;
+        return false;
+    }
+    rangeTree = (TTree*)rangeFile->Get("NRooTrackerVtx");
+    if (!rangeTree) {
+        std::cerr << "Tree 'NRooTrackerVtx' not found in file " << input << std::endl;
+        CloseRangeInput();
+        return false;
+    }
+    rangeInput = input;
+    applyBranchPatterns(rangeTree, patterns);
+    rangeBaskets = patterns.empty() && MatchRangeBranches();
+    return true;
+}
+
+void SkimWriter::CloseRangeInput() {
+    if (rangeFile) {
+        rangeFile->Close();
+        delete rangeFile;
+    }
+    rangeFile = nullptr;
+    rangeTree = nullptr;
+    rangeInput.clear();
+    rangeLeaves.clear();
+    rangeBaskets = false;
+}
+
+// Pair every output leaf with the input leaf of the same name. Baskets can
+// only be copied between identical branch structures. The output clones
+// array must also be able to hold the largest input entry: unlike
+// TTreeCloner, we cannot raise the maximum of the output Vtx branch, so the
+// entries of an input with larger entries are re-packed (which raises it).
+bool SkimWriter::MatchRangeBranches() {
+    rangeLeaves.clear();
+    TObjArray* outLeaves = outTree->GetListOfLeaves();
+    TObjArray* inLeaves = rangeTree->GetListOfLeaves();
+    if (!outLeaves || !inLeaves || outLeaves->GetEntriesFast() != inLeaves->GetEntriesFast()) return false;
+
+    for (Int_t l = 0; l < outLeaves->GetEntriesFast(); ++l) {
+        LeafPair pair;
+        pair.toLeaf = (TLeaf*)outLeaves->UncheckedAt(l);
+        pair.to = pair.toLeaf->GetBranch();
+        pair.from = rangeTree->GetBranch(pair.to->GetName());
+        pair.fromLeaf = pair.from ? pair.from->GetLeaf(pair.toLeaf->GetName()) : nullptr;
+        if (!pair.fromLeaf) return false;
+        rangeLeaves.push_back(pair);
+    }
+
+    TBranchElement* inVtx = dynamic_cast<TBranchElement*>(rangeTree->GetBranch("Vtx"));
+    TBranchElement* outVtx = dynamic_cast<TBranchElement*>(outTree->GetBranch("Vtx"));
+    return inVtx && outVtx && inVtx->GetMaximum() <= outVtx->GetMaximum();
+}
+
+// Whether every branch stores entries [start, end) of rangeTree in whole
+// baskets on disk, which then are baskets [first, last) of the branch
+bool SkimWriter::CanCopyClusterBaskets(Long64_t start, Long64_t end, std::vector<std::pair<int, int> >& baskets) {
+    baskets.assign(rangeLeaves.size(), std::make_pair(0, 0));
+    for (size_t l = 0; l < rangeLeaves.size(); ++l) {
+        TBranch* from = rangeLeaves[l].from;
+        const Long64_t* basketEntry = from->GetBasketEntry();
+        // Baskets still in memory when the tree was written are not copied
+        int nOnDisk = from->GetWriteBasket();
+
+        int first = 0;
+        while (first < nOnDisk && basketEntry[first] < start) first++;
+        int last = first;
+        while (last < nOnDisk && basketEntry[last] < end) {
+            if (from->GetBasketSeek(last) == 0) return false;
+            last++;
+        }
+        // basketEntry[nOnDisk] is where the in-memory basket starts
+        if (first == last || basketEntry[first] != start || basketEntry[last] != end) return false;
+        baskets[l] = std::make_pair(first, last);
+    }
+    return true;
+}
+
+// Append entries [start, end) of rangeTree to the output by copying their
+// compressed baskets, as TTreeCloner does for whole trees
+bool SkimWriter::CopyClusterBaskets(Long64_t start, Long64_t end, const std::vector<std::pair<int, int> >& baskets) {
+    // The copied baskets must start at the output's own basket boundaries
+    for (size_t l = 0; l < rangeLeaves.size(); ++l) {
+        TBranch* to = rangeLeaves[l].to;
+        to->FlushOneBasket(to->GetWriteBasket());
+    }
+    Long64_t outStart = outTree->GetEntries();
+    if (outStart != markedEntries) outTree->MarkEventCluster();
+
+    bool ok = true;
+    TBasket* basket = new TBasket();
+    for (size_t l = 0; l < rangeLeaves.size() && ok; ++l) {
+        const LeafPair& pair = rangeLeaves[l];
+        // A branch with several leaves is copied with its first one
+        bool copied = false;
+        for (size_t k = 0; k < l && !copied; ++k) copied = rangeLeaves[k].to == pair.to;
+        pair.toLeaf->IncludeRange(pair.fromLeaf);
+        if (copied) continue;
+
+        for (int b = baskets[l].first; b < baskets[l].second; ++b) {
+            if (basket->LoadBasketBuffers(pair.from->GetBasketSeek(b), pair.from->GetBasketBytes()[b], rangeFile, rangeTree) != 0) {
+                std::cerr << "Cannot read basket " << b << " of branch " << pair.from->GetName()
+                          << " in file " << rangeInput << std::endl;
+                ok = false;
+                break;
+            }
+            basket->CopyTo(outFile);
+            pair.to->AddBasket(*basket, kTRUE, outStart + pair.from->GetBasketEntry()[b] - start);
+        }
+    }
+    delete basket;
+    if (!ok) return false;
+
+    outTree->SetEntries(outStart + end - start);
+    outTree->MarkEventCluster();
+    markedEntries = outTree->GetEntries();
+    return true;
+}
+
+bool SkimWriter::CopyRangeFrom(const std::string& input, Long64_t first, Long64_t last) {
+    if (!OpenRangeInput(input)) return false;
+
+    TTree::TClusterIterator clusters = rangeTree->GetClusterIterator(first);
+    Long64_t start;
+    while ((start = clusters.Next()) < last) {
+        Long64_t end = clusters.GetNextEntry();
+        bool wholeCluster = start >= first && end <= last;
+        if (start < first) start = first;
+        if (end > last) end = last;
+
+        std::vector<std::pair<int, int> > baskets;
+        if (rangeBaskets && wholeCluster && CanCopyClusterBaskets(start, end, baskets)) {
+            if (!CopyClusterBaskets(start, end, baskets)) return false;
+            nFastEntries += end - start;
+        } else {
+            std::vector<Long64_t> entries;
+            for (Long64_t e = start; e < end; ++e) entries.push_back(e);
+            copyEntriesSlow(rangeTree, outTree, &entries);
+            AttachOutputBuffers();
+        }
+        nEntries += end - start;
+    }
+    return true;
+}
+
+bool SkimWriter::CopyEventsFrom(const std::string& input, bool allEvents, const std::set<int>& eventIDs) {
+    TFile* in = TFile::Open(input.c_str(), "READ");
+    if (!in || in->IsZombie()) {
+        std::cerr << "Error opening file: " << input << std::endl;
+        delete in;
+        return false;
+    }
+    TTree* inEvt = (TTree*)in->Get("evt");
+    if (!inEvt) {
+        in->Close();
+        delete in;
+        return true;
+    }
+
+    Long64_t n = inEvt->GetEntries();
+    std::vector<Long64_t> entries;
+    if (!allEvents) {
+        int eventID = 0;
+        inEvt->SetBranchAddress("EventID", &eventID);
+        for (Long64_t i = 0; i < n; ++i) {
+            inEvt->GetEntry(i);
+            if (eventIDs.count(eventID)) entries.push_back(i);
+        }
+        inEvt->ResetBranchAddresses();
+    }
+
+    // The evt tree is cloned from the first input that has one, as an input
+    // without reconstruction has no evt tree. Closing the input detaches the
+    // clone from its buffers.
+    if (!outEvt) {
+        outFile->cd();
+        outEvt = inEvt->CloneTree(0);
+        if (!outEvt) {
+            std::cerr << "Cannot create the evt tree of the skim from file " << input << std::endl;
+            in->Close();
+            delete in;
+            return false;
+        }
+    }
+
+    // Selecting every event is a whole tree copy
+    if (allEvents || (Long64_t)entries.size() == n) {
+        if (outEvt->CopyEntries(inEvt, -1, "fast") < 0) {
+            copyEntriesSlow(inEvt, outEvt, nullptr);
+        }
+        nEvents += n;
+    } else {
+        copyEntriesSlow(inEvt, outEvt, &entries);
+        nEvents += entries.size();
+    }
+
+    in->Close();
+    delete in;
+    return true;
+}
+
+bool SkimWriter::Close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    notEmpty.notify_all();
+    if (writerThread.joinable()) writerThread.join();
+    CloseRangeInput();
+
+    if (!outFile) return false;
+    outFile->cd();
+    outTree->Write();
+    if (outEvt) outEvt->Write();
+    // Closing the file deletes the trees
+    outFile->Close();
+    delete outFile;
+    outFile = nullptr;
+    outTree = nullptr;
+    outEvt = nullptr;
+
+    delete outVtxs;
+    outVtxs = nullptr;
+    return !failed;
+}
@@ -0,0 +1,141 @@
+#ifndef SkimWriter_h
+#define SkimWriter_h
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Rtypes.h"
+#include "DecodedEntry.h"
+
+class TFile;
+class TTree;
+class TBranch;
+class TLeaf;
+class TClonesArray;
+
+// Writes a skim (selected vertices and their evt entries) of one or more
+// NRooTrackerVtx files to a new ROOT file.
+//
+// The output trees are empty clones of the input trees, so they have the
+// same branch structure as the inputs. The NRooTrackerVtx tree is cloned from
+// a template input and restricted to the branches matched by 'branchPatterns'
+// (all branches if empty); the evt tree is cloned from the first input that
+// has one. The caller queues work in input order and a writer thread
+// carries it out, so the reading thread does not wait for compression and
+// disk writes:
+//
+//   CopyVertices()  all entries of a file's NRooTrackerVtx tree pass
+//                   unchanged: its compressed baskets are copied without
+//                   decompressing them if the branch structure allows it
+//   CopyVertexRange()
+//                   a run of whole clusters of a file whose entries all pass
+//                   unchanged: their baskets are copied as in CopyVertices()
+//                   if they do not straddle the cluster boundaries, and the
+//                   entries are re-packed otherwise
+//   Write()         one entry of the selected vertices, which are moved
+//                   into the output buffer
+//   CopyEvents()    the evt entries of a file whose EventID is in a set, or
+//                   all of them (again copied basket by basket)
+//
+// ROOT::EnableThreadSafety() must have been called.
+class SkimWriter {
+public:
+    SkimWriter();
+    ~SkimWriter();
+
+    bool Open(const std::string& output, const std::string& templateInput,
+              const std::vector<std::string>& branchPatterns);
+
+    void CopyVertices(const std::string& input);
+    void CopyVertexRange(const std::string& input, Long64_t first, Long64_t last);
+    void Write(std::unique_ptr<DecodedEntry> entry);
+    void CopyEvents(const std::string& input, const std::set<int>& eventIDs);
+    void CopyAllEvents(const std::string& input);
+
+    // Wait for the queued work, write the trees and close the file. Returns
+    // false if anything failed.
+    bool Close();
+
+    // Counters of what was written; read them after Close()
+    Long64_t GetNEntries() const { return nEntries; }
+    Long64_t GetNFastEntries() const { return nFastEntries; }
+    Long64_t GetNVertices() const { return nVertices; }
+    Long64_t GetNEvents() const { return nEvents; }
+
+private:
+    SkimWriter(const SkimWriter&);
+    SkimWriter& operator=(const SkimWriter&);
+
+    struct Item {
+        enum Kind { kEntry, kCopyVertices, kCopyRange, kCopyEvents };
+        Kind kind;
+        std::unique_ptr<DecodedEntry> entry;
+        std::string input;
+        Long64_t first;
+        Long64_t last;
+        bool allEvents;
+        std::set<int> eventIDs;
+
+        Item() : kind(kEntry), first(0), last(0), allEvents(false) {}
+    };
+
+    // An output leaf and the input leaf of the same name, with their branches
+    struct LeafPair {
+        TBranch* from;
+        TBranch* to;
+        TLeaf* fromLeaf;
+        TLeaf* toLeaf;
+    };
+
+    // Entries waiting in the queue before Write() blocks the caller
+    static const size_t kQueueCapacity = 256;
+
+    void Push(std::unique_ptr<Item> item);
+    void WriterLoop();
+    void WriteEntry(DecodedEntry& entry);
+    bool CopyVerticesFrom(const std::string& input);
+    bool CopyRangeFrom(const std::string& input, Long64_t first, Long64_t last);
+    bool OpenRangeInput(const std::string& input);
+    void CloseRangeInput();
+    bool MatchRangeBranches();
+    bool CanCopyClusterBaskets(Long64_t start, Long64_t end, std::vector<std::pair<int, int> >& baskets);
+    bool CopyClusterBaskets(Long64_t start, Long64_t end, const std::vector<std::pair<int, int> >& baskets);
+    bool CopyEventsFrom(const std::string& input, bool allEvents, const std::set<int>& eventIDs);
+    void AttachOutputBuffers();
+
+    TFile* outFile;
+    TTree* outTree;
+    TTree* outEvt;
+    TClonesArray* outVtxs;
+    int outNVtx;
+    std::vector<std::string> patterns;
+
+    // Input of the last CopyVertexRange(), kept open for the following ones
+    std::string rangeInput;
+    TFile* rangeFile;
+    TTree* rangeTree;
+    std::vector<LeafPair> rangeLeaves;
+    bool rangeBaskets;   // whether baskets of rangeTree can be copied at all
+    Long64_t markedEntries;  // output entries at the last marked cluster end
+
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<std::unique_ptr<Item> > queue;
+    bool finished;
+    bool failed;
+    std::thread writerThread;
+
+    Long64_t nEntries;
+    Long64_t nFastEntries;
+    Long64_t nVertices;
+    Long64_t nEvents;
+};
+
+#endif
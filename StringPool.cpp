@@ -0,0 +1,103 @@
+#include "StringPool.h"
+
+#include <cstring>
+
+#include "TObjString.h"
+
+namespace {
+    // Each thread remembers the strings it used last. Vertices of one file
+    // mostly repeat the same few strings, so most lookups are answered here
+    // without taking the pool lock. Pooled strings never change, so reading
+    // them through these pointers needs no lock either.
+    const int kRecentStrings = 16;
+
+    struct RecentStrings {
+        StringHandle handle[kRecentStrings];
+        const std::string* string[kRecentStrings];
+        int next;
+    };
+
+    thread_local RecentStrings recent = {{0}, {nullptr}, 0};
+
+    void remember(StringHandle handle, const std::string* s) {
+        recent.handle[recent.next] = handle;
+        recent.string[recent.next] = s;
+        recent.next = (recent.next + 1) % kRecentStrings;
+    }
+}
+
+bool StringPool::Key::operator==(const Key& other) const {
+    return length == other.length && std::memcmp(chars, other.chars, length) == 0;
+}
+
+// FNV-1a
+size_t StringPool::KeyHash::operator()(const Key& key) const {
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < key.length; ++i) {
+        hash = (hash ^ (unsigned char)key.chars[i]) * 16777619u;
+    }
+    return hash;
+}
+
+StringPool& StringPool::Instance() {
+    static StringPool pool;
+    return pool;
+}
+
+StringPool::StringPool() {
+    // Handle 0 is kNoString
+    strings.push_back(std::string());
+    noString = &strings[kNoString];
+}
+
+StringHandle StringPool::Intern(const char* chars, size_t length) {
+    for (int i = 0; i < kRecentStrings; ++i) {
+        const std::string* s = recent.string[i];
+        if (s && s->size() == length && std::memcmp(s->data(), chars, length) == 0) {
+            return recent.handle[i];
+        }
+    }
+
+    Key key = {chars, length};
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unordered_map<Key, StringHandle, KeyHash>::const_iterator it = handles.find(key);
+    StringHandle handle;
+    if (it != handles.end()) {
+        handle = it->second;
+    } else {
+        handle = (StringHandle)strings.size();
+        strings.push_back(std::string(chars, length));
+        Key pooled = {strings.back().data(), length};
+        handles[pooled] = handle;
+    }
+    remember(handle, &strings[handle]);
+    return handle;
+}
+
+const std::string& StringPool::Get(StringHandle handle) const {
+    if (handle == kNoString) return *noString;
+    for (int i = 0; i < kRecentStrings; ++i) {
+        if (recent.string[i] && recent.handle[i] == handle) return *recent.string[i];
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (handle >= strings.size()) return *noString;
+    remember(handle, &strings[handle]);
+    return strings[handle];
+}
+
+size_t StringPool::GetSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return strings.size() - 1;
+}
+
+StringHandle internObjString(const TObjString* s) {
+    if (!s) return kNoString;
+    const TString& value = s->GetString();
+    return StringPool::Instance().Intern(value.Data(), value.Length());
+}
+
+TObjString* newObjString(StringHandle handle) {
+    if (handle == kNoString) return nullptr;
+    return new TObjString(StringPool::Instance().Get(handle).c_str());
+}
@@ -0,0 +1,69 @@
+#ifndef StringPool_h
+#define StringPool_h
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Rtypes.h"
+
+class TObjString;
+
+// Handle of a string in the StringPool. Equal handles mean equal strings, so
+// copying and comparing strings becomes copying and comparing integers.
+typedef UInt_t StringHandle;
+
+// Handle of an absent string (a null TObjString pointer)
+const StringHandle kNoString = 0;
+
+// Process wide, thread-safe pool of distinct strings.
+//
+// A string is stored once and never removed, so handles and the references
+// returned by Get() stay valid until the end of the program. The pool is
+// meant for the few distinct values of the per-vertex strings (event codes,
+// geometry paths, generator and file names), not for arbitrary text.
+class StringPool {
+public:
+    static StringPool& Instance();
+
+    // Handle of the string with these characters, added if not yet pooled
+    StringHandle Intern(const char* chars, size_t length);
+    StringHandle Intern(const std::string& s) { return Intern(s.data(), s.size()); }
+
+    // The string of a handle; the empty string for kNoString
+    const std::string& Get(StringHandle handle) const;
+
+    // Number of distinct strings
+    size_t GetSize() const;
+
+private:
+    StringPool();
+    StringPool(const StringPool&);
+    StringPool& operator=(const StringPool&);
+
+    // Characters of a pooled string, or of a string being looked up
+    struct Key {
+        const char* chars;
+        size_t length;
+        bool operator==(const Key& other) const;
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    mutable std::mutex mutex;
+    // Indexed by handle; a deque never moves its elements when it grows, so
+    // the keys of 'handles' point into it and every string is stored once
+    std::deque<std::string> strings;
+    std::unordered_map<Key, StringHandle, KeyHash> handles;
+    const std::string* noString;
+};
+
+// Handle of the contents of a TObjString, kNoString for a null pointer
+StringHandle internObjString(const TObjString* s);
+
+// A new TObjString with the string of a handle, null for kNoString
+TObjString* newObjString(StringHandle handle);
+
+#endif
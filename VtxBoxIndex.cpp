@@ -0,0 +1,106 @@
+#include "VtxBoxIndex.h"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace {
+    const char* kIndexFormat = "NRooTrackerVtx-vtxbox-v1";
+    const UInt_t kByteOrderMark = 0x01020304;
+
+    // The nearest float that is not above / below 'value'
+    float floatBelow(double value) {
+        float f = (float)value;
+        return f > value ? std::nextafter(f, -std::numeric_limits<float>::infinity()) : f;
+    }
+    float floatAbove(double value) {
+        float f = (float)value;
+        return f < value ? std::nextafter(f, std::numeric_limits<float>::infinity()) : f;
+    }
+}
+
+void VtxBoxIndex::Reset(const FileIdentity& file) {
+    identity = file;
+    boxes.resize(6 * identity.nEntries);
+    for (Long64_t entry = 0; entry < identity.nEntries; ++entry) {
+        float* box = &boxes[6 * entry];
+        box[0] = box[1] = box[2] = std::numeric_limits<float>::infinity();
+        box[3] = box[4] = box[5] = -std::numeric_limits<float>::infinity();
+    }
+}
+
+void VtxBoxIndex::Add(Long64_t entry, double x, double y, double z) {
+    float* box = &boxes[6 * entry];
+    double p[3] = {x, y, z};
+    for (int a = 0; a < 3; ++a) {
+        // NaN positions leave the box unchanged, as they are in no region
+        if (p[a] < box[a]) box[a] = floatBelow(p[a]);
+        if (p[a] > box[a + 3]) box[a + 3] = floatAbove(p[a]);
+    }
+}
+
+bool VtxBoxIndex::Overlaps(Long64_t entry, const double* min, const double* max) const {
+    const float* box = &boxes[6 * entry];
+    for (int a = 0; a < 3; ++a) {
+        if (box[a + 3] < min[a] || box[a] > max[a]) return false;
+    }
+    return true;
+}
+
+bool VtxBoxIndex::Read(const std::string& cacheDir, const FileIdentity& file) {
+    std::ifstream in(fileCachePath(cacheDir, file.path, ".vtxbox").c_str(), std::ios::binary);
+    if (!in) return false;
+
+    std::string line;
+    if (!std::getline(in, line) || line != kIndexFormat) return false;
+
+    // The indexed range covers the whole file
+    WorkUnit indexed;
+    if (!std::getline(in, line) || !parseWorkUnit(line, indexed)) return false;
+    if (indexed.file.path != file.path || indexed.file.size != file.size ||
+        indexed.file.mtime != file.mtime) {
+        return false;
+    }
+
+    UInt_t mark = 0;
+    if (!in.read((char*)&mark, sizeof(mark)) || mark != kByteOrderMark) return false;
+
+    std::vector<float> cached(6 * indexed.file.nEntries);
+    if (!cached.empty() && !in.read((char*)&cached[0], cached.size() * sizeof(float))) return false;
+
+    identity = indexed.file;
+    boxes.swap(cached);
+    return true;
+}
+
+bool VtxBoxIndex::Write(const std::string& cacheDir) const {
+    if (!makeDirectories(cacheDir)) {
+        std::cerr << "Cannot create index cache directory: " << cacheDir << std::endl;
+        return false;
+    }
+
+    std::string path = fileCachePath(cacheDir, identity.path, ".vtxbox");
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath.c_str(), std::ios::binary);
+    if (!out) {
+        std::cerr << "Cannot write index cache: " << tmpPath << std::endl;
+        return false;
+    }
+
+    WorkUnit indexed;
+    indexed.file = identity;
+    indexed.end = identity.nEntries;
+    out << kIndexFormat << "\n" << formatWorkUnit(indexed) << "\n";
+    out.write((const char*)&kByteOrderMark, sizeof(kByteOrderMark));
+    if (!boxes.empty()) out.write((const char*)&boxes[0], boxes.size() * sizeof(float));
+    out.close();
+
+    if (!out || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot write index cache: " << path << std::endl;
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
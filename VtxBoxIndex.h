@@ -0,0 +1,44 @@
+#ifndef VtxBoxIndex_h
+#define VtxBoxIndex_h
+
+#include <string>
+#include <vector>
+
+#include "Rtypes.h"
+#include "WorkUnit.h"
+
+// Bounding box of the vertex positions (EvtVtx[0..2]) of every entry of one
+// NRooTrackerVtx tree.
+//
+// Queries restricted to a region only need to read the entries whose box
+// meets the region's bounding box. Boxes are stored as floats rounded
+// outwards, so they never exclude a vertex. Entries without vertices have an
+// empty box that meets nothing.
+class VtxBoxIndex {
+public:
+    // Start an index of the entries of this file, all with empty boxes
+    void Reset(const FileIdentity& file);
+
+    // Extend the box of 'entry' to include a vertex position
+    void Add(Long64_t entry, double x, double y, double z);
+
+    // Whether the box of 'entry' meets the closed box [min, max]
+    bool Overlaps(Long64_t entry, const double* min, const double* max) const;
+
+    const FileIdentity& GetIdentity() const { return identity; }
+    Long64_t GetEntries() const { return identity.nEntries; }
+
+    // Per input file cache of indices in 'cacheDir', named like the POT cache
+    // (see PotScan.h). A cached index is used only if the path, size and
+    // modification time of the input are unchanged. The boxes are stored in
+    // the native byte order; files with another byte order are not used.
+    bool Read(const std::string& cacheDir, const FileIdentity& file);
+    bool Write(const std::string& cacheDir) const;
+
+private:
+    FileIdentity identity;
+    // Per entry: min x, y, z followed by max x, y, z
+    std::vector<float> boxes;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef VtxLayout_h
+#define VtxLayout_h
+
+#include "NRooTrackerVtx.h"
+#include "VtxSchema.h"
+
+// Compile-time description of a production layout of ND::NRooTrackerVtx.
+//
+// Productions differ in which optional member groups they write. The loops
+// over vertices (summary, interactive and dump printers) are templates on the
+// layout, instantiated once per layout and selected once per file with
+// dispatchVtxLayout(), so they test compile-time constants instead of the
+// schema.
+//
+// The dictionary has a single in-memory ND::NRooTrackerVtx, which every
+// layout is read into: ROOT matches the members by name and cannot convert a
+// fixed array to other extents. Layouts therefore differ only in the optional
+// member groups, and their extents are those of the compiled class.
+template <bool HasNeut, bool HasSpillInfo>
+struct VtxLayout {
+    // NEUT vector (NE*) and final state interaction (NF*) members
+    static const bool kHasNeut = HasNeut;
+    // TimeInSpill and TruthVertexID
+    static const bool kHasSpillInfo = HasSpillInfo;
+
+    // Fixed array extents. These are the extents of the compiled class;
+    // checkVtxSchema() rejects files written with other extents.
+    enum {
+        kStdHepMax = 100,
+        kNEMaxVc = 100,
+        kNEMaxVert = 100,
+        kNEMaxVcVert = 300
+    };
+
+    static_assert(sizeof(ND::NRooTrackerVtx::StdHepP4) == sizeof(double) * kStdHepMax * 4,
+                  "StdHep extent does not match NRooTrackerVtx.h");
+    static_assert(sizeof(ND::NRooTrackerVtx::NEpvc) == sizeof(float) * kNEMaxVc * 3,
+                  "NEpvc extent does not match NRooTrackerVtx.h");
+    static_assert(sizeof(ND::NRooTrackerVtx::NEposvert) == sizeof(float) * kNEMaxVert * 3,
+                  "NEposvert extent does not match NRooTrackerVtx.h");
+    static_assert(sizeof(ND::NRooTrackerVtx::NEdirvert) == sizeof(float) * kNEMaxVcVert * 3,
+                  "NEdirvert extent does not match NRooTrackerVtx.h");
+};
+
+// Production 6T writes every member
+typedef VtxLayout<true, true> Prod6TLayout;
+
+// Call visitor.Run<Layout>() with the layout of a (checked) schema
+template <class Visitor>
+bool dispatchVtxLayout(const VtxSchema& schema, Visitor& visitor) {
+    if (schema.HasNeut()) {
+        if (schema.HasSpillInfo()) return visitor.template Run<VtxLayout<true, true> >();
+        return visitor.template Run<VtxLayout<true, false> >();
+    }
+    if (schema.HasSpillInfo()) return visitor.template Run<VtxLayout<false, true> >();
+    return visitor.template Run<VtxLayout<false, false> >();
+}
+
+#endif
@@ -0,0 +1,167 @@
+#include "VtxSchema.h"
+
+#include <sstream>
+
+#include "TClass.h"
+#include "TFile.h"
+#include "TList.h"
+#include "TStreamerElement.h"
+#include "TStreamerInfo.h"
+
+namespace {
+    const char* VTX_CLASS = "ND::NRooTrackerVtx";
+
+    // Members read by every mode of the reader
+    const char* REQUIRED_MEMBERS[] = {
+        "EvtCode", "EvtNum", "EvtXSec", "EvtWght", "EvtVtx",
+        "StdHepN", "StdHepPdg", "StdHepStatus", "StdHepP4"
+    };
+
+    const char* NEUT_MEMBERS[] = {
+        "NEnvc", "NEipvc", "NEpvc", "NEiorgvc", "NEiflgvc", "NEicrnvc",
+        "NEnvert", "NEposvert", "NEiflgvert", "NEnvcvert", "NEdirvert",
+        "NEabspvert", "NEabstpvert", "NEipvert", "NEiverti", "NEivertf",
+        "NFnvert", "NFiflag", "NFx", "NFy", "NFz", "NFpx", "NFpy", "NFpz",
+        "NFe", "NFfirststep", "NFnstep", "NFecms2"
+    };
+
+    const char* SPILL_MEMBERS[] = {
+        "TimeInSpill", "TruthVertexID"
+    };
+
+    template <size_t N>
+    bool hasAll(const VtxSchema& schema, const char* (&names)[N]) {
+        for (size_t i = 0; i < N; ++i) {
+            if (!schema.Has(names[i])) return false;
+        }
+        return true;
+    }
+
+    void fillSchema(TStreamerInfo* info, VtxSchema& schema) {
+        schema.classVersion = info->GetClassVersion();
+        schema.members.clear();
+
+        TIter next(info->GetElements());
+        while (TStreamerElement* element = (TStreamerElement*)next()) {
+            // Base classes are described by their own streamer info
+            if (element->IsBase()) continue;
+
+            std::vector<int> extents;
+            for (int d = 0; d < element->GetArrayDim(); ++d) {
+                extents.push_back(element->GetMaxIndex(d));
+            }
+            schema.members[element->GetName()] = extents;
+        }
+    }
+
+    std::string formatExtents(const std::vector<int>& extents) {
+        if (extents.empty()) return "(no fixed extents)";
+        std::ostringstream out;
+        for (size_t d = 0; d < extents.size(); ++d) {
+            out << '[' << extents[d] << ']';
+        }
+        return out.str();
+    }
+}
+
+bool VtxSchema::HasNeut() const {
+    return hasAll(*this, NEUT_MEMBERS);
+}
+
+bool VtxSchema::HasSpillInfo() const {
+    return hasAll(*this, SPILL_MEMBERS);
+}
+
+bool readVtxSchema(TFile* file, VtxSchema& schema) {
+    TList* infos = file->GetStreamerInfoList();
+    if (!infos) return false;
+
+    // A file normally holds one version of the class; if it holds several,
+    // the newest one describes the vertices written last
+    TStreamerInfo* best = nullptr;
+    TIter next(infos);
+    while (TObject* obj = next()) {
+        TStreamerInfo* info = dynamic_cast<TStreamerInfo*>(obj);
+        if (!info || std::string(info->GetName()) != VTX_CLASS) continue;
+        if (!best || info->GetClassVersion() > best->GetClassVersion()) best = info;
+    }
+    if (best) fillSchema(best, schema);
+
+    infos->Delete();
+    delete infos;
+    return best != nullptr;
+}
+
+VtxSchema compiledVtxSchema() {
+    VtxSchema schema;
+    TClass* cl = TClass::GetClass(VTX_CLASS);
+    TStreamerInfo* info = cl ? dynamic_cast<TStreamerInfo*>(cl->GetStreamerInfo()) : nullptr;
+    if (info) fillSchema(info, schema);
+    return schema;
+}
+
+bool checkVtxSchema(const VtxSchema& onFile, std::ostream& err) {
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(REQUIRED_MEMBERS) / sizeof(REQUIRED_MEMBERS[0]); ++i) {
+        if (!onFile.Has(REQUIRED_MEMBERS[i])) {
+            err << "  member " << REQUIRED_MEMBERS[i] << " is missing" << std::endl;
+            ok = false;
+        }
+    }
+
+    // ROOT cannot convert a fixed size array to other extents; it would skip
+    // the member and leave zeros behind
+    VtxSchema compiled = compiledVtxSchema();
+    std::map<std::string, std::vector<int> >::const_iterator it;
+    for (it = onFile.members.begin(); it != onFile.members.end(); ++it) {
+        std::map<std::string, std::vector<int> >::const_iterator own = compiled.members.find(it->first);
+        if (own == compiled.members.end() || own->second == it->second) continue;
+        err << "  member " << it->first << " is " << formatExtents(it->second)
+            << " in the file but " << formatExtents(own->second) << " in NRooTrackerVtx.h" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+bool openVtxSchema(TFile* file, const std::string& filename, VtxSchema& schema) {
+    if (!readVtxSchema(file, schema)) {
+        std::cerr << "No streamer info for " << VTX_CLASS << " in file " << filename << std::endl;
+        return false;
+    }
+    std::ostringstream problems;
+    if (!checkVtxSchema(schema, problems)) {
+        std::cerr << "File " << filename << " was written with an incompatible " << VTX_CLASS
+                  << " (class version " << schema.classVersion << "):\n" << problems.str();
+        return false;
+    }
+    return true;
+}
+
+void printVtxSchema(std::ostream& out, const VtxSchema& schema) {
+    VtxSchema compiled = compiledVtxSchema();
+
+    out << VTX_CLASS << " class version " << schema.classVersion
+        << " (compiled: " << compiled.classVersion << "), "
+        << schema.members.size() << " members" << std::endl;
+    out << "NEUT vector and FSI members: " << (schema.HasNeut() ? "yes" : "no") << std::endl;
+    out << "Spill information members:   " << (schema.HasSpillInfo() ? "yes" : "no") << std::endl;
+
+    std::map<std::string, std::vector<int> >::const_iterator it;
+    std::string missing, extra;
+    for (it = compiled.members.begin(); it != compiled.members.end(); ++it) {
+        if (!schema.Has(it->first)) missing += " " + it->first;
+    }
+    for (it = schema.members.begin(); it != schema.members.end(); ++it) {
+        if (!compiled.Has(it->first)) extra += " " + it->first;
+    }
+    if (!missing.empty()) out << "Not in the file (left at defaults):" << missing << std::endl;
+    if (!extra.empty()) out << "Not in NRooTrackerVtx.h (skipped):" << extra << std::endl;
+
+    std::ostringstream problems;
+    if (checkVtxSchema(schema, problems)) {
+        out << "Compatible with the compiled class" << std::endl;
+    } else {
+        out << "Incompatible with the compiled class:\n" << problems.str();
+    }
+}
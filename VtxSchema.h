@@ -0,0 +1,52 @@
+#ifndef VtxSchema_h
+#define VtxSchema_h
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+class TFile;
+
+// Layout of the ND::NRooTrackerVtx class as stored in one file, taken from the
+// streamer info the file was written with.
+//
+// ROOT matches members by name when it reads a file into the compiled class,
+// so files from other productions can be read as long as every fixed size
+// array they share with the compiled class has the same extents. Members the
+// file does not have keep their default values; members the compiled class
+// does not have are skipped.
+struct VtxSchema {
+    int classVersion;
+    // Member name -> fixed array extents (empty for scalars, objects and
+    // variable length arrays)
+    std::map<std::string, std::vector<int> > members;
+
+    VtxSchema() : classVersion(-1) {}
+
+    bool Has(const std::string& member) const { return members.count(member) > 0; }
+
+    // Optional member groups, see VtxLayout.h
+    bool HasNeut() const;
+    bool HasSpillInfo() const;
+};
+
+// Read the on-file schema of ND::NRooTrackerVtx. Returns false if the file has
+// no streamer info for the class.
+bool readVtxSchema(TFile* file, VtxSchema& schema);
+
+// The schema of the compiled class
+VtxSchema compiledVtxSchema();
+
+// Check that vertices written with 'onFile' can be read into the compiled
+// class: the members all modes rely on are present and the shared fixed size
+// arrays have the compiled extents. Problems are described on 'err'.
+bool checkVtxSchema(const VtxSchema& onFile, std::ostream& err);
+
+// readVtxSchema() followed by checkVtxSchema(), naming the file in errors
+bool openVtxSchema(TFile* file, const std::string& filename, VtxSchema& schema);
+
+// Human readable description, including the differences to the compiled class
+void printVtxSchema(std::ostream& out, const VtxSchema& schema);
+
+#endif
@@ -0,0 +1,183 @@
+#include "VtxSummary.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+
+#include "NRooTrackerVtx.h"
+#include "VtxLayout.h"
+
+const double VtxSummary::kNuEnergyMin = 0.0;
+const double VtxSummary::kNuEnergyMax = 10.0;
+
+namespace {
+    // Strings are written length-prefixed ("<len>:<chars>") so that event
+    // codes containing whitespace survive the round trip.
+    void writeString(std::ostream& out, const std::string& s) {
+        out << s.size() << ':' << s;
+    }
+
+    bool readString(std::istream& in, std::string& s) {
+        size_t len = 0;
+        char sep = 0;
+        if (!(in >> len) || !in.get(sep) || sep != ':') return false;
+        s.resize(len);
+        if (len > 0 && !in.read(&s[0], len)) return false;
+        return true;
+    }
+
+    bool isNeutrino(int pdg) {
+        int apdg = std::abs(pdg);
+        return apdg == 12 || apdg == 14 || apdg == 16;
+    }
+}
+
+VtxSummary::VtxSummary() :
+    nEntries(0),
+    nVertices(0),
+    nReconstructed(0),
+    sumWeight(0),
+    nuEnergyHist(kNuEnergyBins + 2, 0)
+{
+}
+
+template <class Layout>
+void VtxSummary::Fill(const ND::NRooTrackerVtx& vtx, bool reconstructed) {
+    nVertices++;
+    if (reconstructed) nReconstructed++;
+    sumWeight += vtx.EvtWght;
+
+    if (vtx.EvtCodeId != kNoString) {
+        evtCodeCounts[StringPool::Instance().Get(vtx.EvtCodeId)]++;
+    }
+
+    // The incoming neutrino is the first initial state neutrino in StdHep
+    if (vtx.StdHepPdg == nullptr || vtx.StdHepStatus == nullptr) return;
+    for (int j = 0; j < vtx.StdHepN && j < (int)Layout::kStdHepMax; ++j) {
+        if (vtx.StdHepStatus[j] != 0 || !isNeutrino(vtx.StdHepPdg[j])) continue;
+
+        nuPdgCounts[vtx.StdHepPdg[j]]++;
+
+        double energy = vtx.StdHepP4[j][3];
+        int bin;
+        if (energy < kNuEnergyMin) {
+            bin = 0;
+        } else if (energy >= kNuEnergyMax) {
+            bin = kNuEnergyBins + 1;
+        } else {
+            bin = 1 + (int)((energy - kNuEnergyMin) / (kNuEnergyMax - kNuEnergyMin) * kNuEnergyBins);
+        }
+        nuEnergyHist[bin]++;
+        break;
+    }
+}
+
+template void VtxSummary::Fill<VtxLayout<true, true> >(const ND::NRooTrackerVtx&, bool);
+template void VtxSummary::Fill<VtxLayout<true, false> >(const ND::NRooTrackerVtx&, bool);
+template void VtxSummary::Fill<VtxLayout<false, true> >(const ND::NRooTrackerVtx&, bool);
+template void VtxSummary::Fill<VtxLayout<false, false> >(const ND::NRooTrackerVtx&, bool);
+
+void VtxSummary::Merge(const VtxSummary& other) {
+    nEntries += other.nEntries;
+    nVertices += other.nVertices;
+    nReconstructed += other.nReconstructed;
+    sumWeight += other.sumWeight;
+
+    for (std::map<int, Long64_t>::const_iterator it = other.nuPdgCounts.begin(); it != other.nuPdgCounts.end(); ++it) {
+        nuPdgCounts[it->first] += it->second;
+    }
+    for (std::map<std::string, Long64_t>::const_iterator it = other.evtCodeCounts.begin(); it != other.evtCodeCounts.end(); ++it) {
+        evtCodeCounts[it->first] += it->second;
+    }
+    for (size_t i = 0; i < nuEnergyHist.size() && i < other.nuEnergyHist.size(); ++i) {
+        nuEnergyHist[i] += other.nuEnergyHist[i];
+    }
+}
+
+void VtxSummary::Write(std::ostream& out) const {
+    std::streamsize oldPrecision = out.precision(std::numeric_limits<double>::digits10 + 2);
+
+    out << nEntries << ' ' << nVertices << ' ' << nReconstructed << ' ' << sumWeight;
+
+    out << ' ' << nuPdgCounts.size();
+    for (std::map<int, Long64_t>::const_iterator it = nuPdgCounts.begin(); it != nuPdgCounts.end(); ++it) {
+        out << ' ' << it->first << ' ' << it->second;
+    }
+
+    out << ' ' << evtCodeCounts.size();
+    for (std::map<std::string, Long64_t>::const_iterator it = evtCodeCounts.begin(); it != evtCodeCounts.end(); ++it) {
+        out << ' ';
+        writeString(out, it->first);
+        out << ' ' << it->second;
+    }
+
+    out << ' ' << nuEnergyHist.size();
+    for (size_t i = 0; i < nuEnergyHist.size(); ++i) {
+        out << ' ' << nuEnergyHist[i];
+    }
+
+    out.precision(oldPrecision);
+}
+
+bool VtxSummary::Read(std::istream& in) {
+    VtxSummary result;
+    size_t n = 0;
+
+    if (!(in >> result.nEntries >> result.nVertices >> result.nReconstructed >> result.sumWeight)) return false;
+
+    if (!(in >> n)) return false;
+    for (size_t i = 0; i < n; ++i) {
+        int pdg;
+        Long64_t count;
+        if (!(in >> pdg >> count)) return false;
+        result.nuPdgCounts[pdg] = count;
+    }
+
+    if (!(in >> n)) return false;
+    for (size_t i = 0; i < n; ++i) {
+        std::string code;
+        Long64_t count;
+        if (!readString(in, code) || !(in >> count)) return false;
+        result.evtCodeCounts[code] = count;
+    }
+
+    if (!(in >> n) || n != result.nuEnergyHist.size()) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (!(in >> result.nuEnergyHist[i])) return false;
+    }
+
+    *this = result;
+    return true;
+}
+
+void VtxSummary::Print(std::ostream& out) const {
+    out << "NRooTrackerVtx entries: " << nEntries << std::endl;
+    out << "Vertices: " << nVertices << std::endl;
+    out << "Vertices with reconstruction: " << nReconstructed << std::endl;
+    out << "Sum of event weights: " << sumWeight << std::endl;
+
+    out << "\n----- INCOMING NEUTRINOS -----\n";
+    for (std::map<int, Long64_t>::const_iterator it = nuPdgCounts.begin(); it != nuPdgCounts.end(); ++it) {
+        out << std::setw(8) << it->first << " : " << it->second << std::endl;
+    }
+
+    out << "\n----- EVENT CODES -----\n";
+    for (std::map<std::string, Long64_t>::const_iterator it = evtCodeCounts.begin(); it != evtCodeCounts.end(); ++it) {
+        out << std::setw(20) << it->first << " : " << it->second << std::endl;
+    }
+
+    out << "\n----- NEUTRINO ENERGY (GeV) -----\n";
+    double width = (kNuEnergyMax - kNuEnergyMin) / kNuEnergyBins;
+    std::streamsize oldPrecision = out.precision();
+    out << "   underflow : " << nuEnergyHist[0] << std::endl;
+    for (int i = 1; i <= kNuEnergyBins; ++i) {
+        if (nuEnergyHist[i] == 0) continue;
+        out << std::fixed << std::setprecision(2)
+            << std::setw(6) << kNuEnergyMin + (i - 1) * width << "-"
+            << std::setw(6) << kNuEnergyMin + i * width << " : "
+            << nuEnergyHist[i] << std::endl;
+        out.unsetf(std::ios_base::floatfield);
+        out.precision(oldPrecision);
+    }
+    out << "    overflow : " << nuEnergyHist[kNuEnergyBins + 1] << std::endl;
+}
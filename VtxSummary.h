@@ -0,0 +1,58 @@
+#ifndef VtxSummary_h
+#define VtxSummary_h
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Rtypes.h"
+
+namespace ND {
+class NRooTrackerVtx;
+}
+
+// Aggregated statistics for a set of NRooTrackerVtx vertices.
+//
+// A summary is filled per unit of work (a range of entries in one file) and
+// partial summaries are combined with Merge(). Summaries can be serialised to
+// a single line of text so they can be stored in a checkpoint journal and
+// restored on a later run.
+class VtxSummary {
+public:
+    // Binning of the incoming neutrino energy histogram (GeV)
+    static const int kNuEnergyBins = 50;
+    static const double kNuEnergyMin;
+    static const double kNuEnergyMax;
+
+    VtxSummary();
+
+    // Add one vertex of a file with the given layout (VtxLayout.h).
+    // 'reconstructed' tells whether the vertex EvtNum has an entry in the evt
+    // tree. Instantiated for every layout in VtxSummary.cpp.
+    template <class Layout>
+    void Fill(const ND::NRooTrackerVtx& vtx, bool reconstructed);
+
+    // Count one NRooTrackerVtx tree entry
+    void AddEntry() { nEntries++; }
+
+    // Add the contents of another summary to this one
+    void Merge(const VtxSummary& other);
+
+    // Serialise to / restore from a single whitespace separated line
+    void Write(std::ostream& out) const;
+    bool Read(std::istream& in);
+
+    // Human readable report
+    void Print(std::ostream& out) const;
+
+    Long64_t nEntries;
+    Long64_t nVertices;
+    Long64_t nReconstructed;
+    double sumWeight;
+    std::map<int, Long64_t> nuPdgCounts;
+    std::map<std::string, Long64_t> evtCodeCounts;
+    std::vector<Long64_t> nuEnergyHist; // kNuEnergyBins + underflow + overflow
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "WorkUnit.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "TTree.h"
+
+bool statFileIdentity(const std::string& filename, FileIdentity& identity) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0) {
+        return false;
+    }
+
+    char resolved[PATH_MAX];
+    if (realpath(filename.c_str(), resolved)) {
+        identity.path = resolved;
+    } else {
+        identity.path = filename;
+    }
+    identity.size = st.st_size;
+    identity.mtime = st.st_mtime;
+    return true;
+}
+
+std::string fileCachePath(const std::string& cacheDir, const std::string& path, const std::string& extension) {
+    // FNV-1a, so cache file names do not depend on the standard library
+    ULong64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < path.size(); ++i) {
+        hash ^= (unsigned char)path[i];
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream text;
+    text << cacheDir << '/' << std::hex << std::setw(16) << std::setfill('0') << hash << extension;
+    return text.str();
+}
+
+std::string defaultCacheDir(const std::string& name) {
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) return std::string(xdg) + "/root_reader/" + name;
+    const char* home = getenv("HOME");
+    if (home && *home) return std::string(home) + "/.cache/root_reader/" + name;
+    return "";
+}
+
+bool makeDirectories(const std::string& dir) {
+    for (size_t slash = dir.find('/', 1); ; slash = dir.find('/', slash + 1)) {
+        std::string prefix = dir.substr(0, slash);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (slash == std::string::npos) return true;
+    }
+}
+
+std::string formatWorkUnit(const WorkUnit& unit) {
+    std::ostringstream text;
+    text << unit.file.path << '\t' << unit.file.size << '\t' << unit.file.mtime << '\t'
+         << unit.file.nEntries << '\t' << unit.begin << '\t' << unit.end;
+    return text.str();
+}
+
+bool parseWorkUnit(const std::string& text, WorkUnit& unit) {
+    size_t tab = text.find('\t');
+    if (tab == std::string::npos || tab == 0) return false;
+
+    WorkUnit result;
+    result.file.path = text.substr(0, tab);
+    std::istringstream numbers(text.substr(tab + 1));
+    if (!(numbers >> result.file.size >> result.file.mtime >> result.file.nEntries >> result.begin >> result.end)) {
+        return false;
+    }
+    if (result.begin < 0 || result.end < result.begin) return false;
+
+    unit = result;
+    return true;
+}
+
+std::vector<WorkUnit> planWorkUnits(TTree* tree, const FileIdentity& file, Long64_t targetEntries) {
+    std::vector<WorkUnit> units;
+    Long64_t nEntries = tree->GetEntries();
+    if (targetEntries <= 0) targetEntries = nEntries;
+
+    WorkUnit unit;
+    unit.file = file;
+    unit.begin = 0;
+
+    TTree::TClusterIterator clusters = tree->GetClusterIterator(0);
+    Long64_t clusterStart;
+    while ((clusterStart = clusters.Next()) < nEntries) {
+        // Close the current unit once it has reached the target size
+        if (clusterStart > unit.begin && clusterStart - unit.begin >= targetEntries) {
+            unit.end = clusterStart;
+            units.push_back(unit);
+            unit.begin = clusterStart;
+        }
+    }
+
+    if (unit.begin < nEntries) {
+        unit.end = nEntries;
+        units.push_back(unit);
+    }
+    return units;
+}
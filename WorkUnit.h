@@ -0,0 +1,63 @@
+#ifndef WorkUnit_h
+#define WorkUnit_h
+
+#include <string>
+#include <vector>
+
+#include "Rtypes.h"
+
+class TTree;
+
+// Identifies one input file well enough to notice that it has changed
+// between two runs: canonical path, size, modification time and the number
+// of entries in the NRooTrackerVtx tree.
+struct FileIdentity {
+    std::string path;
+    Long64_t size;
+    Long64_t mtime;
+    Long64_t nEntries;
+
+    FileIdentity() : size(0), mtime(0), nEntries(0) {}
+
+    bool operator==(const FileIdentity& other) const {
+        return path == other.path && size == other.size &&
+               mtime == other.mtime && nEntries == other.nEntries;
+    }
+    bool operator!=(const FileIdentity& other) const { return !(*this == other); }
+};
+
+// Fill path, size and mtime of 'identity' from the file system.
+// Returns false if the file cannot be stat'ed.
+bool statFileIdentity(const std::string& filename, FileIdentity& identity);
+
+// Path of the cache file of an input in 'cacheDir': a hash of the input's
+// canonical path followed by 'extension'
+std::string fileCachePath(const std::string& cacheDir, const std::string& path, const std::string& extension);
+
+// Default directory of one kind of per-file cache: $XDG_CACHE_HOME/root_reader/<name>,
+// falling back to $HOME/.cache/root_reader/<name>. Empty if neither variable is set.
+std::string defaultCacheDir(const std::string& name);
+
+// Create a directory and its missing parents (mkdir -p)
+bool makeDirectories(const std::string& dir);
+
+// A contiguous range [begin, end) of NRooTrackerVtx entries in one file
+struct WorkUnit {
+    FileIdentity file;
+    Long64_t begin;
+    Long64_t end;
+
+    WorkUnit() : begin(0), end(0) {}
+};
+
+// Tab separated text form of a unit:
+//   <path>\t<size>\t<mtime>\t<nEntries>\t<begin>\t<end>
+std::string formatWorkUnit(const WorkUnit& unit);
+bool parseWorkUnit(const std::string& text, WorkUnit& unit);
+
+// Split the entries of 'tree' into units of roughly 'targetEntries' entries.
+// Unit boundaries are aligned to the tree's cluster boundaries so that no
+// compressed basket has to be read by two units.
+std::vector<WorkUnit> planWorkUnits(TTree* tree, const FileIdentity& file, Long64_t targetEntries);
+
+#endif
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TClonesArray.h"
+#include "TStopwatch.h"
+
+// Include the necessary class definitions
+#include "RooTrackerVtxBase.h"
+#include "JNuBeamFlux.h"
+#include "NRooTrackerVtx.h"
+#include "FlatEventStore.h"
+#include "VtxSchema.h"
+
+// Append all vertices of one NRooTrackerVtx file. 'entryOffset' is added to
+// the tree entry numbers so that entries stay unique across input files.
+bool exportFile(const std::string& filename, Long64_t entryOffset, FlatEventWriter& writer, Long64_t& nEntries) {
+    TFile* file = TFile::Open(filename.c_str(), "READ");
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+    TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+    if (!nuTree) {
+        std::cerr << "Tree 'NRooTrackerVtx' not found in file " << filename << std::endl;
+        file->Close();
+        delete file;
+        return false;
+    }
+    VtxSchema schema;
+    if (!openVtxSchema(file, filename, schema)) {
+        file->Close();
+        delete file;
+        return false;
+    }
+
+    TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+    int NRooVtx = 0;
+    nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+    nuTree->SetBranchAddress("NVtx", &NRooVtx);
+
+    nEntries = nuTree->GetEntries();
+    for (Long64_t entry = 0; entry < nEntries; ++entry) {
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+
+        for (int i = 0; i < NRooVtx; ++i) {
+            ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+            if (!vtx) continue;
+
+            int64_t globalEntry = entryOffset + entry;
+            int32_t vtxIndex = i;
+            int32_t evtNum = vtx->EvtNum;
+            float nuEnusk = vtx->NuEnusk;
+            int32_t nuParentPdg = vtx->NuParentPdg;
+            writer.Append(kColEntry, &globalEntry, 1);
+            writer.Append(kColVtxIndex, &vtxIndex, 1);
+            writer.Append(kColEvtNum, &evtNum, 1);
+            writer.Append(kColEvtXSec, &vtx->EvtXSec, 1);
+            writer.Append(kColEvtWght, &vtx->EvtWght, 1);
+            writer.Append(kColEvtVtx, vtx->EvtVtx, 1);
+            writer.Append(kColNuEnusk, &nuEnusk, 1);
+            writer.Append(kColNuParentPdg, &nuParentPdg, 1);
+
+            // The 4-vectors are fixed [100][4] arrays in the class
+            int nParticles = vtx->StdHepN;
+            if (nParticles < 0 || vtx->StdHepPdg == nullptr || vtx->StdHepStatus == nullptr) nParticles = 0;
+            if (nParticles > 100) nParticles = 100;
+            writer.Append(kColStdHepPdg, vtx->StdHepPdg, nParticles);
+            writer.Append(kColStdHepStatus, vtx->StdHepStatus, nParticles);
+            writer.Append(kColStdHepP4, vtx->StdHepP4, nParticles);
+            writer.Append(kColStdHepX4, vtx->StdHepX4, nParticles);
+
+            int nNF = vtx->NFnvert;
+            if (nNF < 0 || vtx->NFiflag == nullptr) nNF = 0;
+            writer.Append(kColNFiflag, vtx->NFiflag, nNF);
+            writer.Append(kColNFx, vtx->NFx, nNF);
+            writer.Append(kColNFy, vtx->NFy, nNF);
+            writer.Append(kColNFz, vtx->NFz, nNF);
+            writer.Append(kColNFpx, vtx->NFpx, nNF);
+            writer.Append(kColNFpy, vtx->NFpy, nNF);
+            writer.Append(kColNFpz, vtx->NFpz, nNF);
+            writer.Append(kColNFe, vtx->NFe, nNF);
+            writer.Append(kColNFfirststep, vtx->NFfirststep, nNF);
+
+            writer.EndVertex(nParticles, nNF);
+        }
+    }
+
+    nuTree->ResetBranchAddresses();
+    delete nRooVtxs;
+    file->Close();
+    delete file;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <output.flat> <root_file> [<root_file> ...]" << std::endl;
+        return 1;
+    }
+
+    std::string output = argv[1];
+    FlatEventWriter writer;
+    if (!writer.Open(output)) {
+        return 1;
+    }
+
+    TStopwatch timer;
+    timer.Start();
+
+    Long64_t entryOffset = 0;
+    for (int i = 2; i < argc; ++i) {
+        Long64_t nEntries = 0;
+        if (!exportFile(argv[i], entryOffset, writer, nEntries)) {
+            return 1;
+        }
+        std::cout << argv[i] << ": " << nEntries << " entries, first entry number " << entryOffset << std::endl;
+        entryOffset += nEntries;
+    }
+
+    if (!writer.Finish()) {
+        return 1;
+    }
+    timer.Stop();
+
+    std::cout << "Exported " << writer.GetNVertices() << " vertices from " << entryOffset
+              << " entries to " << output << " in " << timer.RealTime() << " s" << std::endl;
+    return 0;
+}
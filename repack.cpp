@@ -0,0 +1,354 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TObjArray.h"
+#include "TClonesArray.h"
+#include "TStopwatch.h"
+#include "Compression.h"
+
+// Include the necessary class definitions
+#include "RooTrackerVtxBase.h"
+#include "JNuBeamFlux.h"
+#include "NRooTrackerVtx.h"
+#include "VtxSchema.h"
+
+// Columns read by the "subset" throughput measurement: what a typical
+// selection touches
+const char* SUBSET_BRANCHES[] = {
+    "NVtx",
+    "Vtx.EvtNum",
+    "Vtx.EvtWght",
+    "Vtx.EvtVtx*",
+    "Vtx.StdHepN",
+    "Vtx.StdHepPdg*",
+    "Vtx.StdHepStatus*",
+    "Vtx.StdHepP4*"
+};
+
+struct RepackOptions {
+    ROOT::RCompressionSetting::EAlgorithm::EValues algorithm;
+    int level;
+    int basketSize;        // bytes per basket buffer
+    Long64_t clusterSize;  // entries per cluster
+    bool zeroPadding;      // zero the unused rows of the fixed size arrays
+    bool benchmark;        // measure read throughput before and after
+
+    RepackOptions() :
+        algorithm(ROOT::RCompressionSetting::EAlgorithm::kLZ4),
+        level(4),
+        basketSize(512000),
+        clusterSize(1000),
+        zeroPadding(false),
+        benchmark(true) {}
+};
+
+struct ReadStats {
+    Long64_t fileBytes;
+    Long64_t zipBytes;
+    Long64_t totBytes;
+    Long64_t nEntries;
+    double fullSeconds;
+    double subsetSeconds;
+
+    ReadStats() : fileBytes(0), zipBytes(0), totBytes(0), nEntries(0), fullSeconds(0), subsetSeconds(0) {}
+};
+
+bool parseAlgorithm(const std::string& name, ROOT::RCompressionSetting::EAlgorithm::EValues& algorithm) {
+    if (name == "lz4") {
+        algorithm = ROOT::RCompressionSetting::EAlgorithm::kLZ4;
+    } else if (name == "zstd") {
+        algorithm = ROOT::RCompressionSetting::EAlgorithm::kZSTD;
+    } else if (name == "zlib") {
+        algorithm = ROOT::RCompressionSetting::EAlgorithm::kZLIB;
+    } else if (name == "lzma") {
+        algorithm = ROOT::RCompressionSetting::EAlgorithm::kLZMA;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Zero the rows of the fixed size arrays beyond their counters. The arrays
+// are part of the class layout, so the rows cannot be dropped from the file
+// without breaking every reader; zeroed rows compress to almost nothing.
+void zeroUnusedPadding(ND::NRooTrackerVtx* vtx) {
+    for (int i = (vtx->StdHepN > 0 ? vtx->StdHepN : 0); i < 100; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            vtx->StdHepX4[i][j] = 0;
+            vtx->StdHepP4[i][j] = 0;
+        }
+        for (int j = 0; j < 3; ++j) {
+            vtx->StdHepPolz[i][j] = 0;
+        }
+    }
+    for (int i = (vtx->NEnvc > 0 ? vtx->NEnvc : 0); i < 100; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            vtx->NEpvc[i][j] = 0;
+        }
+    }
+    for (int i = (vtx->NEnvert > 0 ? vtx->NEnvert : 0); i < 100; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            vtx->NEposvert[i][j] = 0;
+        }
+    }
+    for (int i = (vtx->NEnvcvert > 0 ? vtx->NEnvcvert : 0); i < 300; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            vtx->NEdirvert[i][j] = 0;
+        }
+    }
+}
+
+// Read the whole NRooTrackerVtx tree, then only the subset columns, and
+// report the time taken for each pass
+bool measureReadThroughput(const std::string& filename, ReadStats& stats) {
+    TFile* file = TFile::Open(filename.c_str(), "READ");
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return false;
+    }
+    TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+    if (!nuTree) {
+        std::cerr << "Tree 'NRooTrackerVtx' not found in file " << filename << std::endl;
+        file->Close();
+        delete file;
+        return false;
+    }
+
+    stats.fileBytes = file->GetSize();
+    stats.zipBytes = nuTree->GetZipBytes();
+    stats.totBytes = nuTree->GetTotBytes();
+    stats.nEntries = nuTree->GetEntries();
+
+    TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+    int NRooVtx = 0;
+    nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+    nuTree->SetBranchAddress("NVtx", &NRooVtx);
+
+    TStopwatch timer;
+    timer.Start();
+    for (Long64_t entry = 0; entry < stats.nEntries; ++entry) {
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+    }
+    timer.Stop();
+    stats.fullSeconds = timer.RealTime();
+
+    nuTree->SetBranchStatus("*", 0);
+    for (size_t i = 0; i < sizeof(SUBSET_BRANCHES) / sizeof(SUBSET_BRANCHES[0]); ++i) {
+        nuTree->SetBranchStatus(SUBSET_BRANCHES[i], 1);
+    }
+    timer.Start();
+    for (Long64_t entry = 0; entry < stats.nEntries; ++entry) {
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+    }
+    timer.Stop();
+    stats.subsetSeconds = timer.RealTime();
+
+    nuTree->ResetBranchAddresses();
+    delete nRooVtxs;
+    file->Close();
+    delete file;
+    return true;
+}
+
+// Copy the NRooTrackerVtx and evt trees of 'input' into 'output' with the
+// requested compression and layout
+bool repackFile(const std::string& input, const std::string& output, const RepackOptions& options) {
+    TFile* inFile = TFile::Open(input.c_str(), "READ");
+    if (!inFile || inFile->IsZombie()) {
+        std::cerr << "Error opening file: " << input << std::endl;
+        return false;
+    }
+    TTree* nuTree = (TTree*)inFile->Get("NRooTrackerVtx");
+    if (!nuTree) {
+        std::cerr << "Tree 'NRooTrackerVtx' not found in file " << input << std::endl;
+        inFile->Close();
+        delete inFile;
+        return false;
+    }
+    // The vertices are rewritten through the compiled class, so it must be
+    // able to hold everything the input has
+    VtxSchema schema;
+    if (!openVtxSchema(inFile, input, schema)) {
+        inFile->Close();
+        delete inFile;
+        return false;
+    }
+    TTree* evtTree = (TTree*)inFile->Get("evt");
+    if (!evtTree) {
+        std::cerr << "Tree 'evt' not found in file. Only NRooTrackerVtx will be repacked." << std::endl;
+    }
+
+    TObjArray* branches = nuTree->GetListOfBranches();
+    for (int i = 0; i < branches->GetEntriesFast(); ++i) {
+        std::string name = branches->At(i)->GetName();
+        if (name != "Vtx" && name != "NVtx") {
+            std::cerr << "Warning: branch '" << name << "' of NRooTrackerVtx is not copied" << std::endl;
+        }
+    }
+
+    TFile* outFile = new TFile(output.c_str(), "RECREATE", "",
+                               ROOT::CompressionSettings(options.algorithm, options.level));
+    if (outFile->IsZombie()) {
+        std::cerr << "Error creating file: " << output << std::endl;
+        delete outFile;
+        inFile->Close();
+        delete inFile;
+        return false;
+    }
+
+    TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+    int NRooVtx = 0;
+    nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+    nuTree->SetBranchAddress("NVtx", &NRooVtx);
+
+    // A new tree rather than a clone, so the split level and basket sizes
+    // are ours and not inherited from the input
+    outFile->cd();
+    TTree* outTree = new TTree("NRooTrackerVtx", nuTree->GetTitle());
+    outTree->Branch("NVtx", &NRooVtx, "NVtx/I", options.basketSize);
+    outTree->Branch("Vtx", &nRooVtxs, options.basketSize, 99);
+    outTree->SetAutoFlush(options.clusterSize);
+
+    Long64_t nEntries = nuTree->GetEntries();
+    for (Long64_t entry = 0; entry < nEntries; ++entry) {
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+
+        if (options.zeroPadding) {
+            for (int i = 0; i < NRooVtx; ++i) {
+                ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+                if (vtx) zeroUnusedPadding(vtx);
+            }
+        }
+        outTree->Fill();
+    }
+    outTree->Write();
+    std::cout << "Repacked " << nEntries << " NRooTrackerVtx entries" << std::endl;
+
+    if (evtTree) {
+        outFile->cd();
+        TTree* outEvt = evtTree->CloneTree(0);
+        outEvt->SetAutoFlush(options.clusterSize);
+        // The clone's branches keep the compression of the input branches,
+        // and a fast copy would keep the input baskets. Both are replaced so
+        // the evt tree is recompressed with the requested codec.
+        TObjArray* evtBranches = outEvt->GetListOfBranches();
+        for (int i = 0; i < evtBranches->GetEntriesFast(); ++i) {
+            ((TBranch*)evtBranches->At(i))->SetCompressionSettings(ROOT::CompressionSettings(options.algorithm, options.level));
+        }
+        outEvt->CopyEntries(evtTree, -1, "");
+        outEvt->Write();
+        std::cout << "Repacked " << evtTree->GetEntries() << " evt entries" << std::endl;
+    }
+
+    outFile->Close();
+    delete outFile;
+
+    nuTree->ResetBranchAddresses();
+    delete nRooVtxs;
+    inFile->Close();
+    delete inFile;
+    return true;
+}
+
+void printStats(const std::string& label, const ReadStats& stats) {
+    double mb = 1024.0 * 1024.0;
+    std::cout << std::left << std::setw(8) << label << std::right << std::fixed << std::setprecision(2)
+              << std::setw(12) << stats.fileBytes / mb
+              << std::setw(12) << stats.zipBytes / mb
+              << std::setw(12) << (stats.zipBytes > 0 ? (double)stats.totBytes / stats.zipBytes : 0.0)
+              << std::setw(12) << stats.fullSeconds
+              << std::setw(12) << (stats.fullSeconds > 0 ? stats.totBytes / mb / stats.fullSeconds : 0.0)
+              << std::setw(12) << (stats.fullSeconds > 0 ? stats.nEntries / stats.fullSeconds : 0.0)
+              << std::setw(12) << stats.subsetSeconds
+              << std::endl;
+    std::cout.unsetf(std::ios_base::floatfield);
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <input.root> <output.root>" << std::endl;
+    std::cerr << "\nOptions:" << std::endl;
+    std::cerr << "  --codec <lz4|zstd|zlib|lzma>  compression algorithm (default: lz4)" << std::endl;
+    std::cerr << "  --level <n>                   compression level (default: 4)" << std::endl;
+    std::cerr << "  --basket-size <bytes>         basket buffer size per branch (default: 512000)" << std::endl;
+    std::cerr << "  --cluster-entries <n>         entries per cluster (default: 1000); use a divisor of" << std::endl;
+    std::cerr << "                                the --unit-size of root_reader.exe" << std::endl;
+    std::cerr << "  --zero-padding                zero unused rows of the [100]/[300] arrays" << std::endl;
+    std::cerr << "  --no-benchmark                skip the before/after read measurement" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    RepackOptions options;
+    std::vector<std::string> filenames;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--codec" && i + 1 < argc) {
+                if (!parseAlgorithm(argv[++i], options.algorithm)) {
+                    std::cerr << "Unknown codec: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--level" && i + 1 < argc) {
+                options.level = std::stoi(argv[++i]);
+            } else if (arg == "--basket-size" && i + 1 < argc) {
+                options.basketSize = std::stoi(argv[++i]);
+            } else if (arg == "--cluster-entries" && i + 1 < argc) {
+                options.clusterSize = std::stoll(argv[++i]);
+            } else if (arg == "--zero-padding") {
+                options.zeroPadding = true;
+            } else if (arg == "--no-benchmark") {
+                options.benchmark = false;
+            } else if (arg.size() > 1 && arg[0] == '-') {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            } else {
+                filenames.push_back(arg);
+            }
+        } catch (...) {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (filenames.size() != 2 || options.basketSize <= 0 || options.clusterSize <= 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ReadStats before, after;
+    if (options.benchmark && !measureReadThroughput(filenames[0], before)) {
+        return 1;
+    }
+    if (!repackFile(filenames[0], filenames[1], options)) {
+        return 1;
+    }
+    if (options.benchmark) {
+        if (!measureReadThroughput(filenames[1], after)) {
+            return 1;
+        }
+
+        std::cout << "\n" << std::left << std::setw(8) << "" << std::right
+                  << std::setw(12) << "file MB"
+                  << std::setw(12) << "tree MB"
+                  << std::setw(12) << "ratio"
+                  << std::setw(12) << "full s"
+                  << std::setw(12) << "full MB/s"
+                  << std::setw(12) << "entries/s"
+                  << std::setw(12) << "subset s" << std::endl;
+        printStats("before", before);
+        printStats("after", after);
+        std::cout << "\nNote: the output was just written and is likely in the page cache;"
+                  << " repeat the measurement on a cold cache for disk-bound numbers." << std::endl;
+    }
+
+    return 0;
+}
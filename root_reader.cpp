@@ -5,6 +5,15 @@
 #include <cstdio>
 #include <map>
 #include <set>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <climits>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <unistd.h>
 
 #include "TFile.h"
 #include "TTree.h"
@@ -12,11 +21,27 @@
 #include "TObject.h"
 #include "TClonesArray.h"
 #include "TObjString.h"
+#include "TStopwatch.h"
+#include "TROOT.h"
 
 // Include the necessary class definitions
 #include "RooTrackerVtxBase.h"
 #include "JNuBeamFlux.h"
 #include "NRooTrackerVtx.h"
+#include "VtxSummary.h"
+#include "WorkUnit.h"
+#include "CheckpointJournal.h"
+#include "Sharding.h"
+#include "Sampling.h"
+#include "EntryBrowser.h"
+#include "VtxSchema.h"
+#include "VtxLayout.h"
+#include "PotScan.h"
+#include "StringPool.h"
+#include "SkimWriter.h"
+#include "DetectorRegions.h"
+#include "VtxBoxIndex.h"
+#include "ReorderBuffer.h"
 
 // Define neutrino PDG codes for easy reference
 const std::map<int, std::string> PDG_MAP = {
@@ -54,7 +79,175 @@ std::string getParticleState(int status) {
     return "Intermediate";
 }
 
+// Collect the EventIDs of all entries in the evt tree (reconstructed events).
+// Only the EventID column is read.
+void collectReconstructedEventIDs(TTree* evtTree, std::set<int>& eventIDs) {
+    int eventID;
+    evtTree->SetBranchStatus("*", 0);
+    evtTree->SetBranchStatus("EventID", 1);
+    evtTree->SetBranchAddress("EventID", &eventID);
+    
+    Long64_t nEvtEntries = evtTree->GetEntries();
+    std::cout << "Found " << nEvtEntries << " entries in the evt tree (reconstructed events)" << std::endl;
+    
+    for (Long64_t i = 0; i < nEvtEntries; ++i) {
+        evtTree->GetEntry(i);
+        eventIDs.insert(eventID);
+    }
+    evtTree->ResetBranchAddresses();
+    evtTree->SetBranchStatus("*", 1);
+    
+    std::cout << "Collected " << eventIDs.size() << " unique reconstructed Event IDs" << std::endl;
+}
+
+// Print one row of a particle table
+void printParticleRow(std::ostream& out, const ND::NRooTrackerVtx* vtx, int j) {
+    char row[256];
+    snprintf(row, sizeof(row), "| %3d | %11s | %9.3f | %9.3f | %9.3f | %9.3f | %-11s |\n", 
+             j, 
+             getPDGName(vtx->StdHepPdg[j]).c_str(), 
+             vtx->StdHepP4[j][0], 
+             vtx->StdHepP4[j][1], 
+             vtx->StdHepP4[j][2], 
+             vtx->StdHepP4[j][3],
+             getParticleState(vtx->StdHepStatus[j]).c_str());
+    out << row;
+}
+
+// Print the details of one vertex of a file with the given layout
+template <class Layout>
+void printVertex(std::ostream& out, Long64_t entry, int i, const ND::NRooTrackerVtx* vtx, bool reconstructed) {
+    out << "\n========== Entry " << entry << ", Vertex " << i << " ==========\n";
+    out << "Event Number: " << vtx->EvtNum << std::endl;
+    if (reconstructed) {
+        out << "This event has reconstruction data in the evt tree" << std::endl;
+    }
+    
+    // Print event information
+    out << "Event XSec: " << vtx->EvtXSec << " (1E-38 cm^2)" << std::endl;
+    out << "Event Weight: " << vtx->EvtWght << std::endl;
+    out << "Vertex Position (x,y,z,t): (" 
+         << vtx->EvtVtx[0] << ", " 
+         << vtx->EvtVtx[1] << ", " 
+         << vtx->EvtVtx[2] << ", " 
+         << vtx->EvtVtx[3] << ")" << std::endl;
+    
+    // Print neutrino flux information
+    out << "Neutrino Parent PDG: " << vtx->NuParentPdg << std::endl;
+    out << "Neutrino Energy: " << vtx->NuEnusk << " GeV" << std::endl;
+    
+    // Print event code if available
+    if (vtx->EvtCodeId != kNoString) {
+        const std::string& evtCodeStr = StringPool::Instance().Get(vtx->EvtCodeId);
+        out << "Event Code: " << evtCodeStr << std::endl;
+        
+        // Try to parse interaction type if possible
+        if (evtCodeStr.find("NuMuCC") != std::string::npos) {
+            out << "Interaction Type: Muon Neutrino Charged Current" << std::endl;
+        } else if (evtCodeStr.find("NuMuNC") != std::string::npos) {
+            out << "Interaction Type: Muon Neutrino Neutral Current" << std::endl;
+        } else if (evtCodeStr.find("NuECC") != std::string::npos) {
+            out << "Interaction Type: Electron Neutrino Charged Current" << std::endl;
+        } else if (evtCodeStr.find("NuENC") != std::string::npos) {
+            out << "Interaction Type: Electron Neutrino Neutral Current" << std::endl;
+        }
+    }
+    
+    // Print information about all particles in the event
+    out << "\nNumber of particles: " << vtx->StdHepN << std::endl;
+    
+    // Never index past the fixed size momentum array
+    int nParticles = vtx->StdHepN < (int)Layout::kStdHepMax ? vtx->StdHepN : (int)Layout::kStdHepMax;
+    
+    // First print initial state particles
+    out << "\n----- INITIAL STATE PARTICLES -----\n";
+    out << "-------------------------------------------------------------------------------------\n";
+    out << "| Idx |     PDG     |    Px    |    Py    |    Pz    |    E     |   Status   |\n";
+    out << "-------------------------------------------------------------------------------------\n";
+    
+    bool hasInitial = false;
+    for (int j = 0; j < nParticles; ++j) {
+        // Check pointers
+        if (vtx->StdHepPdg != nullptr && vtx->StdHepStatus != nullptr) {
+            // Print only initial state particles (status == 0)
+            if (vtx->StdHepStatus[j] == 0) {
+                hasInitial = true;
+                printParticleRow(out, vtx, j);
+            }
+        }
+    }
+    
+    if (!hasInitial) {
+        out << "| No initial state particles found                                             |\n";
+    }
+    out << "-------------------------------------------------------------------------------------\n";
+    
+    // Then print final state particles
+    out << "\n----- FINAL STATE PARTICLES -----\n";
+    out << "-------------------------------------------------------------------------------------\n";
+    out << "| Idx |     PDG     |    Px    |    Py    |    Pz    |    E     |   Status   |\n";
+    out << "-------------------------------------------------------------------------------------\n";
+    
+    bool hasFinal = false;
+    for (int j = 0; j < nParticles; ++j) {
+        // Check pointers
+        if (vtx->StdHepPdg != nullptr && vtx->StdHepStatus != nullptr) {
+            // Print only final state particles (status == 1)
+            if (vtx->StdHepStatus[j] == 1) {
+                hasFinal = true;
+                printParticleRow(out, vtx, j);
+            }
+        }
+    }
+    
+    if (!hasFinal) {
+        out << "| No final state particles found                                                |\n";
+    }
+    out << "-------------------------------------------------------------------------------------\n";
+    
+    // Print intermediate state particles if any
+    bool hasIntermediate = false;
+    for (int j = 0; j < nParticles; ++j) {
+        if (vtx->StdHepStatus != nullptr && vtx->StdHepStatus[j] != 0 && vtx->StdHepStatus[j] != 1) {
+            hasIntermediate = true;
+            break;
+        }
+    }
+    
+    if (hasIntermediate) {
+        out << "\n----- INTERMEDIATE PARTICLES -----\n";
+        out << "-------------------------------------------------------------------------------------\n";
+        out << "| Idx |     PDG     |    Px    |    Py    |    Pz    |    E     |   Status   |\n";
+        out << "-------------------------------------------------------------------------------------\n";
+        
+        for (int j = 0; j < nParticles; ++j) {
+            // Check pointers
+            if (vtx->StdHepPdg != nullptr && vtx->StdHepStatus != nullptr) {
+                // Print intermediate particles (status != 0 and status != 1)
+                if (vtx->StdHepStatus[j] != 0 && vtx->StdHepStatus[j] != 1) {
+                    printParticleRow(out, vtx, j);
+                }
+            }
+        }
+        out << "-------------------------------------------------------------------------------------\n";
+    }
+}
+
+// Prints one vertex; chosen once per file by its layout
+typedef void (*VertexPrinter)(std::ostream&, Long64_t, int, const ND::NRooTrackerVtx*, bool);
+
+struct SelectVertexPrinter {
+    VertexPrinter printer;
+    template <class Layout> bool Run() {
+        printer = &printVertex<Layout>;
+        return true;
+    }
+};
+
 void processRootFile(const std::string& filename) {
+    // The interactive browser decodes entries on background threads
+    ROOT::EnableThreadSafety();
+    
     // Open the ROOT file
     TFile* file = TFile::Open(filename.c_str(), "READ");
     if (!file || file->IsZombie()) {
@@ -70,6 +263,16 @@ void processRootFile(const std::string& filename) {
         return;
     }
     
+    // Check the production layout of the file and pick the matching printer
+    VtxSchema schema;
+    if (!openVtxSchema(file, filename, schema)) {
+        file->Close();
+        delete file;
+        return;
+    }
+    SelectVertexPrinter select;
+    dispatchVtxLayout(schema, select);
+    
     // Get the evt tree
     TTree* evtTree = (TTree*)file->Get("evt");
     if (!evtTree) {
@@ -81,28 +284,9 @@ void processRootFile(const std::string& filename) {
     
     // If evt tree exists, get all event IDs that have reconstruction
     if (evtTree) {
-        int eventID;
-        evtTree->SetBranchAddress("EventID", &eventID);
-        
-        Long64_t nEvtEntries = evtTree->GetEntries();
-        std::cout << "Found " << nEvtEntries << " entries in the evt tree (reconstructed events)" << std::endl;
-        
-        for (Long64_t i = 0; i < nEvtEntries; ++i) {
-            evtTree->GetEntry(i);
-            reconstructedEventIDs.insert(eventID);
-        }
-        
-        std::cout << "Collected " << reconstructedEventIDs.size() << " unique reconstructed Event IDs" << std::endl;
+        collectReconstructedEventIDs(evtTree, reconstructedEventIDs);
     }
     
-    // Set up the TClonesArray to hold the NRooTrackerVtx objects
-    TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
-    int NRooVtx = 0;
-    
-    // Set branch addresses
-    nuTree->SetBranchAddress("Vtx", &nRooVtxs);
-    nuTree->SetBranchAddress("NVtx", &NRooVtx);
-    
     // Get the number of entries
     Long64_t nEntries = nuTree->GetEntries();
     std::cout << "Total NRooTrackerVtx entries: " << nEntries << std::endl;
@@ -129,198 +313,1819 @@ void processRootFile(const std::string& filename) {
         filterReconstructed = (input == "y" || input == "Y");
     }
     
-    int processedEntries = 0;
+    // Entries with at least one printed vertex. Going back to an entry does
+    // not count it again.
+    std::set<Long64_t> shownEntries;
     
-    // Loop over entries
-    for (Long64_t entry = 0; entry < nEntries && processedEntries < maxEntries; ++entry) {
-        // Clear previous event data
-        nRooVtxs->Clear();
-        
-        // Get entry
-        nuTree->GetEntry(entry);
+    // All further reads of the tree go through the browser, which decodes
+    // the following entries in the background while the user reads
+    // (scoped so the browser stops before the file is closed)
+    {
+        EntryBrowser browser(nuTree, filename);
+        Long64_t entry = 0;
         
-        // Loop over vertices in this entry
-        for (int i = 0; i < NRooVtx; ++i) {
-            ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
-            if (!vtx) continue;
-            
-            // Check if this event is reconstructed (if filtering)
-            if (filterReconstructed && reconstructedEventIDs.find(vtx->EvtNum) == reconstructedEventIDs.end()) {
-                continue;
-            }
-            
-            // We have a valid vertex to process
-            processedEntries++;
-            
-            std::cout << "\n========== Entry " << entry << ", Vertex " << i << " ==========\n";
-            std::cout << "Event Number: " << vtx->EvtNum << std::endl;
-            if (filterReconstructed) {
-                std::cout << "This event has reconstruction data in the evt tree" << std::endl;
-            }
-            
-            // Print event information
-            std::cout << "Event XSec: " << vtx->EvtXSec << " (1E-38 cm^2)" << std::endl;
-            std::cout << "Event Weight: " << vtx->EvtWght << std::endl;
-            std::cout << "Vertex Position (x,y,z,t): (" 
-                      << vtx->EvtVtx[0] << ", " 
-                      << vtx->EvtVtx[1] << ", " 
-                      << vtx->EvtVtx[2] << ", " 
-                      << vtx->EvtVtx[3] << ")" << std::endl;
+        while ((Long64_t)shownEntries.size() < maxEntries && entry < nEntries) {
+            std::shared_ptr<const DecodedEntry> decoded = browser.Get(entry);
             
-            // Print neutrino flux information
-            std::cout << "Neutrino Parent PDG: " << vtx->NuParentPdg << std::endl;
-            std::cout << "Neutrino Energy: " << vtx->NuEnusk << " GeV" << std::endl;
-            
-            // Print event code if available
-            if (vtx->EvtCode) {
-                std::string evtCodeStr = vtx->EvtCode->GetString().Data();
-                std::cout << "Event Code: " << evtCodeStr << std::endl;
+            // Loop over vertices in this entry
+            for (size_t i = 0; i < decoded->vertices.size(); ++i) {
+                const ND::NRooTrackerVtx* vtx = decoded->vertices[i];
+                if (!vtx) continue;
                 
-                // Try to parse interaction type if possible
-                if (evtCodeStr.find("NuMuCC") != std::string::npos) {
-                    std::cout << "Interaction Type: Muon Neutrino Charged Current" << std::endl;
-                } else if (evtCodeStr.find("NuMuNC") != std::string::npos) {
-                    std::cout << "Interaction Type: Muon Neutrino Neutral Current" << std::endl;
-                } else if (evtCodeStr.find("NuECC") != std::string::npos) {
-                    std::cout << "Interaction Type: Electron Neutrino Charged Current" << std::endl;
-                } else if (evtCodeStr.find("NuENC") != std::string::npos) {
-                    std::cout << "Interaction Type: Electron Neutrino Neutral Current" << std::endl;
-                }
-            }
-            
-            // Print information about all particles in the event
-            std::cout << "\nNumber of particles: " << vtx->StdHepN << std::endl;
-            
-            // First print initial state particles
-            std::cout << "\n----- INITIAL STATE PARTICLES -----\n";
-            std::cout << "-------------------------------------------------------------------------------------\n";
-            std::cout << "| Idx |     PDG     |    Px    |    Py    |    Pz    |    E     |   Status   |\n";
-            std::cout << "-------------------------------------------------------------------------------------\n";
-            
-            bool hasInitial = false;
-            for (int j = 0; j < vtx->StdHepN; ++j) {
-                // Check pointers
-                if (vtx->StdHepPdg != nullptr && vtx->StdHepStatus != nullptr) {
-                    // Print only initial state particles (status == 0)
-                    if (vtx->StdHepStatus[j] == 0) {
-                        hasInitial = true;
-                        printf("| %3d | %11s | %9.3f | %9.3f | %9.3f | %9.3f | %-11s |\n", 
-                               j, 
-                               getPDGName(vtx->StdHepPdg[j]).c_str(), 
-                               vtx->StdHepP4[j][0], 
-                               vtx->StdHepP4[j][1], 
-                               vtx->StdHepP4[j][2], 
-                               vtx->StdHepP4[j][3],
-                               getParticleState(vtx->StdHepStatus[j]).c_str());
-                    }
+                // Check if this event is reconstructed (if filtering)
+                if (filterReconstructed && reconstructedEventIDs.find(vtx->EvtNum) == reconstructedEventIDs.end()) {
+                    continue;
                 }
+                
+                // We have a valid vertex to process
+                shownEntries.insert(entry);
+                select.printer(std::cout, entry, (int)i, vtx, filterReconstructed);
             }
             
-            if (!hasInitial) {
-                std::cout << "| No initial state particles found                                             |\n";
+            // Check if we've reached our limit
+            if ((Long64_t)shownEntries.size() >= maxEntries) {
+                break;
             }
-            std::cout << "-------------------------------------------------------------------------------------\n";
             
-            // Then print final state particles
-            std::cout << "\n----- FINAL STATE PARTICLES -----\n";
-            std::cout << "-------------------------------------------------------------------------------------\n";
-            std::cout << "| Idx |     PDG     |    Px    |    Py    |    Pz    |    E     |   Status   |\n";
-            std::cout << "-------------------------------------------------------------------------------------\n";
-            
-            bool hasFinal = false;
-            for (int j = 0; j < vtx->StdHepN; ++j) {
-                // Check pointers
-                if (vtx->StdHepPdg != nullptr && vtx->StdHepStatus != nullptr) {
-                    // Print only final state particles (status == 1)
-                    if (vtx->StdHepStatus[j] == 1) {
-                        hasFinal = true;
-                        printf("| %3d | %11s | %9.3f | %9.3f | %9.3f | %9.3f | %-11s |\n", 
-                               j, 
-                               getPDGName(vtx->StdHepPdg[j]).c_str(), 
-                               vtx->StdHepP4[j][0], 
-                               vtx->StdHepP4[j][1], 
-                               vtx->StdHepP4[j][2], 
-                               vtx->StdHepP4[j][3],
-                               getParticleState(vtx->StdHepStatus[j]).c_str());
+            // Ask user where to go next
+            bool lastEntry = (entry == nEntries - 1);
+            bool quit = false;
+            bool moved = false;
+            while (!moved && !quit) {
+                if (lastEntry) {
+                    std::cout << "\nThis is the last entry. Press 'p' for the previous one, 'g <entry>' to go to an entry,\n"
+                              << "'e <EvtNum>' to go to an event, or 'q' to quit: ";
+                } else {
+                    std::cout << "\nPress Enter for the next entry, 'p' for the previous one, 'g <entry>' to go to an entry,\n"
+                              << "'e <EvtNum>' to go to an event, or 'q' to quit: ";
+                }
+                std::string input;
+                // At the end of the input (e.g. piped runs) go on with the next
+                // entry, and stop after the last one
+                if (!std::getline(std::cin, input)) {
+                    if (lastEntry) {
+                        quit = true;
+                        break;
                     }
+                    input.clear();
                 }
-            }
-            
-            if (!hasFinal) {
-                std::cout << "| No final state particles found                                                |\n";
-            }
-            std::cout << "-------------------------------------------------------------------------------------\n";
-            
-            // Print intermediate state particles if any
-            bool hasIntermediate = false;
-            for (int j = 0; j < vtx->StdHepN; ++j) {
-                if (vtx->StdHepStatus != nullptr && vtx->StdHepStatus[j] != 0 && vtx->StdHepStatus[j] != 1) {
-                    hasIntermediate = true;
+                if (input == "q" || input == "Q") {
+                    quit = true;
                     break;
                 }
-            }
-            
-            if (hasIntermediate) {
-                std::cout << "\n----- INTERMEDIATE PARTICLES -----\n";
-                std::cout << "-------------------------------------------------------------------------------------\n";
-                std::cout << "| Idx |     PDG     |    Px    |    Py    |    Pz    |    E     |   Status   |\n";
-                std::cout << "-------------------------------------------------------------------------------------\n";
                 
-                for (int j = 0; j < vtx->StdHepN; ++j) {
-                    // Check pointers
-                    if (vtx->StdHepPdg != nullptr && vtx->StdHepStatus != nullptr) {
-                        // Print intermediate particles (status != 0 and status != 1)
-                        if (vtx->StdHepStatus[j] != 0 && vtx->StdHepStatus[j] != 1) {
-                            printf("| %3d | %11s | %9.3f | %9.3f | %9.3f | %9.3f | %-11s |\n", 
-                                   j, 
-                                   getPDGName(vtx->StdHepPdg[j]).c_str(), 
-                                   vtx->StdHepP4[j][0], 
-                                   vtx->StdHepP4[j][1], 
-                                   vtx->StdHepP4[j][2], 
-                                   vtx->StdHepP4[j][3],
-                                   getParticleState(vtx->StdHepStatus[j]).c_str());
-                        }
+                std::string command;
+                std::string argument;
+                std::istringstream words(input);
+                words >> command >> argument;
+                
+                Long64_t target = -1;
+                if (command.empty() || command == "n") {
+                    if (lastEntry) {
+                        std::cout << "Already at the last entry" << std::endl;
+                        continue;
+                    }
+                    target = entry + 1;
+                } else if (command == "p") {
+                    target = entry - 1;
+                } else if (command == "g") {
+                    try {
+                        target = std::stoll(argument);
+                    } catch (...) {
+                        target = -1;
+                    }
+                } else if (command == "e") {
+                    int evtNum = 0;
+                    try {
+                        evtNum = std::stoi(argument);
+                    } catch (...) {
+                        std::cout << "Invalid EvtNum: " << argument << std::endl;
+                        continue;
+                    }
+                    if (!browser.FindEvtNum(evtNum, target)) {
+                        std::cout << "No vertex with EvtNum " << evtNum << std::endl;
+                        continue;
                     }
+                } else {
+                    std::cout << "Unknown command: " << input << std::endl;
+                    continue;
                 }
-                std::cout << "-------------------------------------------------------------------------------------\n";
+                
+                if (target < 0 || target >= nEntries) {
+                    std::cout << "Entry out of range (0-" << nEntries - 1 << ")" << std::endl;
+                    continue;
+                }
+                entry = target;
+                moved = true;
             }
-            
-            // Check if we've reached our limit
-            if (processedEntries >= maxEntries) {
+            if (quit) {
                 break;
             }
         }
+    }
+    
+    // Clean up
+    file->Close();
+    delete file;
+}
+
+// Options of the non-interactive summary mode
+struct SummaryOptions {
+    bool recoOnly;              // only count vertices with an entry in the evt tree
+    std::string checkpointFile; // journal of completed units, empty for none
+    Long64_t unitSize;          // target number of entries per unit
+    int jobs;                   // number of local worker processes
+    std::string shardDir;       // directory shared with the worker processes
+
+    SummaryOptions() : recoOnly(false), unitSize(10000), jobs(1) {}
+};
+
+// Options the partial results depend on. Stored with checkpoints and shard
+// plans so results obtained with different settings are never mixed.
+std::string summaryConfigKey(bool recoOnly) {
+    return std::string("recoOnly=") + (recoOnly ? "1" : "0");
+}
+
+bool parseConfigKey(const std::string& configKey, bool& recoOnly) {
+    if (configKey == summaryConfigKey(false)) {
+        recoOnly = false;
+    } else if (configKey == summaryConfigKey(true)) {
+        recoOnly = true;
+    } else {
+        std::cerr << "Unknown summary configuration: " << configKey << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Columns VtxSummary::Fill() uses
+const char* SUMMARY_BRANCHES[] = {
+    "NVtx",
+    "Vtx.EvtNum",
+    "Vtx.EvtWght",
+    "Vtx.EvtCode*",
+    "Vtx.StdHepN",
+    "Vtx.StdHepPdg*",
+    "Vtx.StdHepStatus*",
+    "Vtx.StdHepP4*"
+};
+
+// Aggregate the vertices of entries [unit.begin, unit.end) of nuTree, a file
+// with the given layout. Only the summary columns are read.
+template <class Layout>
+void summarizeUnit(TTree* nuTree, TClonesArray* nRooVtxs, const int& NRooVtx,
+                   const WorkUnit& unit, const std::set<int>& reconstructedEventIDs,
+                   bool recoOnly, VtxSummary& summary) {
+    for (Long64_t entry = unit.begin; entry < unit.end; ++entry) {
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+        summary.AddEntry();
         
-        // Check if we've reached our limit
-        if (processedEntries >= maxEntries) {
-            break;
+        for (int i = 0; i < NRooVtx; ++i) {
+            ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+            if (!vtx) continue;
+            
+            bool reconstructed = reconstructedEventIDs.find(vtx->EvtNum) != reconstructedEventIDs.end();
+            if (recoOnly && !reconstructed) continue;
+            
+            summary.Fill<Layout>(*vtx, reconstructed);
+        }
+    }
+}
+
+// Pointer to the summarizeUnit() instantiation of one layout
+typedef void (*UnitSummarizer)(TTree*, TClonesArray*, const int&, const WorkUnit&,
+                               const std::set<int>&, bool, VtxSummary&);
+
+struct SelectUnitSummarizer {
+    UnitSummarizer summarize;
+    template <class Layout> bool Run() {
+        summarize = &summarizeUnit<Layout>;
+        return true;
+    }
+};
+
+// Split every file into cluster-aligned units of work
+bool planSummaryUnits(const std::vector<std::string>& filenames, Long64_t unitSize, std::vector<WorkUnit>& units) {
+    for (size_t f = 0; f < filenames.size(); ++f) {
+        const std::string& filename = filenames[f];
+        
+        FileIdentity identity;
+        if (!statFileIdentity(filename, identity)) {
+            std::cerr << "Cannot access file: " << filename << std::endl;
+            return false;
         }
         
-        // Ask user if they want to continue to the next entry
-        if (entry < nEntries - 1 && processedEntries < maxEntries) {
-            std::cout << "\nPress Enter to process next entry, or 'q' to quit: ";
-            std::string input;
-            std::getline(std::cin, input);
-            if (input == "q" || input == "Q") {
-                break;
-            }
+        TFile* file = TFile::Open(filename.c_str(), "READ");
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            return false;
+        }
+        
+        TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+        if (!nuTree) {
+            std::cerr << "Tree 'NRooTrackerVtx' not found in file " << filename << std::endl;
+            file->Close();
+            delete file;
+            return false;
+        }
+        VtxSchema schema;
+        if (!openVtxSchema(file, filename, schema)) {
+            file->Close();
+            delete file;
+            return false;
+        }
+        identity.nEntries = nuTree->GetEntries();
+        
+        std::vector<WorkUnit> fileUnits = planWorkUnits(nuTree, identity, unitSize);
+        units.insert(units.end(), fileUnits.begin(), fileUnits.end());
+        
+        file->Close();
+        delete file;
+    }
+    return true;
+}
+
+// Called with the index and partial summary of every unit that finished
+typedef std::function<bool(size_t, const VtxSummary&)> UnitDoneCallback;
+
+// Process a list of units. Consecutive units of the same file share one
+// opened file and one set of reconstructed event IDs. Fails if a file changed
+// since its units were planned.
+bool summarizeUnits(const std::vector<WorkUnit>& units, bool recoOnly, const UnitDoneCallback& unitDone) {
+    size_t u = 0;
+    while (u < units.size()) {
+        const FileIdentity& planned = units[u].file;
+        
+        FileIdentity identity;
+        if (!statFileIdentity(planned.path, identity)) {
+            std::cerr << "Cannot access file: " << planned.path << std::endl;
+            return false;
+        }
+        
+        TFile* file = TFile::Open(planned.path.c_str(), "READ");
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error opening file: " << planned.path << std::endl;
+            return false;
+        }
+        
+        TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+        if (nuTree) identity.nEntries = nuTree->GetEntries();
+        if (!nuTree || identity != planned) {
+            std::cerr << "File changed since its units were planned: " << planned.path << std::endl;
+            file->Close();
+            delete file;
+            return false;
+        }
+        
+        // The summary loop is chosen once per file by its layout
+        VtxSchema schema;
+        if (!openVtxSchema(file, planned.path, schema)) {
+            file->Close();
+            delete file;
+            return false;
+        }
+        SelectUnitSummarizer select;
+        dispatchVtxLayout(schema, select);
+        
+        std::set<int> reconstructedEventIDs;
+        TTree* evtTree = (TTree*)file->Get("evt");
+        if (evtTree) {
+            collectReconstructedEventIDs(evtTree, reconstructedEventIDs);
+        } else if (recoOnly) {
+            std::cerr << "Tree 'evt' not found in file " << planned.path << ", no vertex passes --reco-only" << std::endl;
+        }
+        
+        TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+        int NRooVtx = 0;
+        nuTree->SetBranchStatus("*", 0);
+        for (size_t b = 0; b < sizeof(SUMMARY_BRANCHES) / sizeof(SUMMARY_BRANCHES[0]); ++b) {
+            nuTree->SetBranchStatus(SUMMARY_BRANCHES[b], 1);
+        }
+        nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+        nuTree->SetBranchAddress("NVtx", &NRooVtx);
+        
+        bool ok = true;
+        for (; ok && u < units.size() && units[u].file == planned; ++u) {
+            VtxSummary partial;
+            select.summarize(nuTree, nRooVtxs, NRooVtx, units[u], reconstructedEventIDs, recoOnly, partial);
+            ok = unitDone(u, partial);
         }
+        
+        nuTree->ResetBranchAddresses();
+        delete nRooVtxs;
+        file->Close();
+        delete file;
+        
+        if (!ok) return false;
+    }
+    return true;
+}
+
+void printSummary(const VtxSummary& total) {
+    std::cout << "========== SUMMARY ==========\n";
+    total.Print(std::cout);
+}
+
+// Summarise all vertices of the given files in this process. With a
+// checkpoint journal, units completed by an earlier (possibly interrupted)
+// run are taken from the journal and only missing or changed units are read.
+bool summarizeFiles(const std::vector<std::string>& filenames, const SummaryOptions& options) {
+    CheckpointJournal journal;
+    bool useJournal = !options.checkpointFile.empty();
+    if (useJournal) {
+        if (!journal.Open(options.checkpointFile, summaryConfigKey(options.recoOnly))) {
+            return false;
+        }
+        std::cout << "Loaded " << journal.GetNRecords() << " completed unit(s) from " << options.checkpointFile << std::endl;
     }
     
-    // Clean up
-    delete nRooVtxs;
-    file->Close();
-    delete file;
+    std::vector<WorkUnit> units;
+    if (!planSummaryUnits(filenames, options.unitSize, units)) {
+        return false;
+    }
+    
+    // Partial results are merged in unit order so the total does not depend
+    // on which units came from the journal
+    std::vector<VtxSummary> partials(units.size());
+    std::vector<WorkUnit> missing;
+    std::vector<size_t> missingIndex;
+    for (size_t u = 0; u < units.size(); ++u) {
+        if (!useJournal || !journal.Find(units[u], partials[u])) {
+            missing.push_back(units[u]);
+            missingIndex.push_back(u);
+        }
+    }
+    std::cout << units.size() << " unit(s) in " << filenames.size() << " file(s), "
+              << missing.size() << " to process" << std::endl;
+    
+    bool ok = summarizeUnits(missing, options.recoOnly,
+        [&](size_t i, const VtxSummary& partial) {
+            if (useJournal) journal.Record(missing[i], partial);
+            partials[missingIndex[i]] = partial;
+            return true;
+        });
+    if (!ok) return false;
+    
+    VtxSummary total;
+    for (size_t u = 0; u < partials.size(); ++u) {
+        total.Merge(partials[u]);
+    }
+    
+    std::cout << "\nProcessed " << missing.size() << " unit(s), reused " << units.size() - missing.size()
+              << " unit(s) from checkpoint\n" << std::endl;
+    printSummary(total);
+    return true;
 }
 
-int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <root_file>" << std::endl;
-        return 1;
+// Write the shard plan of the given files to options.shardDir
+bool planShards(const std::vector<std::string>& filenames, const SummaryOptions& options, ShardPlan& plan) {
+    plan.configKey = summaryConfigKey(options.recoOnly);
+    plan.shards.clear();
+    if (!planSummaryUnits(filenames, options.unitSize, plan.shards)) {
+        return false;
+    }
+    if (!writeShardPlan(options.shardDir, plan)) {
+        return false;
+    }
+    std::cout << "Planned " << plan.shards.size() << " shard(s) of " << filenames.size()
+              << " file(s) in " << options.shardDir << std::endl;
+    return true;
+}
+
+// Process the shards of 'dir' owned by worker 'rank' of 'nRanks'. Shards
+// that already have a result (from an earlier attempt) are skipped.
+bool runShardWorker(const std::string& dir, int rank, int nRanks) {
+    ShardPlan plan;
+    bool recoOnly = false;
+    if (!readShardPlan(dir, plan) || !parseConfigKey(plan.configKey, recoOnly)) {
+        return false;
     }
     
-    std::string filename = argv[1];
-    processRootFile(filename);
+    std::vector<WorkUnit> mine;
+    std::vector<size_t> shardIndex;
+    for (size_t i = 0; i < plan.shards.size(); ++i) {
+        VtxSummary done;
+        if ((int)(i % nRanks) != rank || readShardResult(dir, i, done)) continue;
+        mine.push_back(plan.shards[i]);
+        shardIndex.push_back(i);
+    }
     
-    return 0;
-}
\ No newline at end of file
+    return summarizeUnits(mine, recoOnly,
+        [&](size_t i, const VtxSummary& partial) {
+            return writeShardResult(dir, shardIndex[i], partial);
+        });
+}
+
+// Merge and print the results of all shards in 'dir'
+bool mergeShards(const std::string& dir) {
+    ShardPlan plan;
+    VtxSummary total;
+    if (!readShardPlan(dir, plan) || !mergeShardResults(dir, plan, total)) {
+        return false;
+    }
+    std::cout << "Merged " << plan.shards.size() << " shard(s) from " << dir << "\n" << std::endl;
+    printSummary(total);
+    return true;
+}
+
+// Local coordinator: plan the shards, run options.jobs worker processes on
+// this machine and merge their results
+bool summarizeFilesSharded(const std::vector<std::string>& filenames, SummaryOptions options, const std::string& executable) {
+    bool temporaryDir = options.shardDir.empty();
+    if (temporaryDir) {
+        char dirTemplate[] = "/tmp/root_reader_shards_XXXXXX";
+        if (!mkdtemp(dirTemplate)) {
+            std::cerr << "Cannot create shard directory" << std::endl;
+            return false;
+        }
+        options.shardDir = dirTemplate;
+    }
+    
+    ShardPlan plan;
+    bool ok = planShards(filenames, options, plan) &&
+              runLocalWorkers(executable, options.shardDir, options.jobs) &&
+              mergeShards(options.shardDir);
+    
+    if (temporaryDir) {
+        removeShardDirectory(options.shardDir, plan);
+    }
+    return ok;
+}
+
+// Options of the sampling (quick-look) mode
+struct SampleOptions {
+    double fraction;         // fraction of clusters to sample, 0 if unused
+    Long64_t reservoirSize;  // exact number of entries to sample, 0 if unused
+    ULong64_t seed;
+    bool recoOnly;
+
+    SampleOptions() : fraction(0), reservoirSize(0), seed(12345), recoOnly(false) {}
+};
+
+// Below this number of clusters the sampling mode samples single entries,
+// otherwise the error estimates would rest on too few units
+const size_t MIN_SAMPLE_CLUSTERS = 20;
+
+// Columns read in sampling mode
+const char* SAMPLE_BRANCHES[] = {
+    "NVtx",
+    "Vtx.EvtNum",
+    "Vtx.EvtWght",
+    "Vtx.StdHepN",
+    "Vtx.StdHepPdg*",
+    "Vtx.StdHepStatus*",
+    "Vtx.StdHepP4*"
+};
+
+// Open every file once to learn its number of entries and (optionally) its
+// clusters, which are the units of cluster sampling
+bool scanSampleInputs(const std::vector<std::string>& filenames, bool wantClusters,
+                      std::vector<Long64_t>& fileEntries, std::vector<WorkUnit>& clusters) {
+    for (size_t f = 0; f < filenames.size(); ++f) {
+        TFile* file = TFile::Open(filenames[f].c_str(), "READ");
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error opening file: " << filenames[f] << std::endl;
+            return false;
+        }
+        TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+        if (!nuTree) {
+            std::cerr << "Tree 'NRooTrackerVtx' not found in file " << filenames[f] << std::endl;
+            file->Close();
+            delete file;
+            return false;
+        }
+        VtxSchema schema;
+        if (!openVtxSchema(file, filenames[f], schema)) {
+            file->Close();
+            delete file;
+            return false;
+        }
+        fileEntries.push_back(nuTree->GetEntries());
+        
+        if (wantClusters) {
+            FileIdentity identity;
+            identity.path = filenames[f];
+            identity.nEntries = fileEntries.back();
+            std::vector<WorkUnit> fileClusters = planWorkUnits(nuTree, identity, 1);
+            clusters.insert(clusters.end(), fileClusters.begin(), fileClusters.end());
+        }
+        
+        file->Close();
+        delete file;
+    }
+    return true;
+}
+
+// Turn sorted global entry numbers into single-entry units
+std::vector<WorkUnit> entriesToUnits(const std::vector<std::string>& filenames, const std::vector<Long64_t>& fileEntries,
+                                     const std::vector<ULong64_t>& globalEntries) {
+    std::vector<WorkUnit> units;
+    size_t f = 0;
+    Long64_t fileStart = 0;
+    for (size_t i = 0; i < globalEntries.size(); ++i) {
+        Long64_t global = (Long64_t)globalEntries[i];
+        while (global >= fileStart + fileEntries[f]) {
+            fileStart += fileEntries[f];
+            f++;
+        }
+        WorkUnit unit;
+        unit.file.path = filenames[f];
+        unit.file.nEntries = fileEntries[f];
+        unit.begin = global - fileStart;
+        unit.end = unit.begin + 1;
+        units.push_back(unit);
+    }
+    return units;
+}
+
+// Read the sampled units (sorted by file) and fill the statistics. Only the
+// sampling columns are enabled, so only their baskets in the sampled
+// clusters are read and decompressed.
+bool readSampleUnits(const std::vector<WorkUnit>& units, bool recoOnly, SampleStats& stats, bool& hasRecoInfo) {
+    hasRecoInfo = true;
+    size_t u = 0;
+    while (u < units.size()) {
+        const std::string& path = units[u].file.path;
+        
+        TFile* file = TFile::Open(path.c_str(), "READ");
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error opening file: " << path << std::endl;
+            return false;
+        }
+        TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+        if (!nuTree) {
+            std::cerr << "Tree 'NRooTrackerVtx' not found in file " << path << std::endl;
+            file->Close();
+            delete file;
+            return false;
+        }
+        
+        size_t fileEnd = u;
+        while (fileEnd < units.size() && units[fileEnd].file.path == path) fileEnd++;
+        
+        TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+        int NRooVtx = 0;
+        nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+        nuTree->SetBranchAddress("NVtx", &NRooVtx);
+        
+        // The evt entries are not aligned with the NRooTrackerVtx entries, so
+        // the whole EventID column is read (one integer per evt entry)
+        std::set<int> reconstructedEventIDs;
+        TTree* evtTree = (TTree*)file->Get("evt");
+        if (evtTree) {
+            collectReconstructedEventIDs(evtTree, reconstructedEventIDs);
+        } else {
+            hasRecoInfo = false;
+        }
+        
+        nuTree->SetBranchStatus("*", 0);
+        for (size_t b = 0; b < sizeof(SAMPLE_BRANCHES) / sizeof(SAMPLE_BRANCHES[0]); ++b) {
+            nuTree->SetBranchStatus(SAMPLE_BRANCHES[b], 1);
+        }
+        
+        for (; u < fileEnd; ++u) {
+            stats.BeginUnit();
+            for (Long64_t entry = units[u].begin; entry < units[u].end; ++entry) {
+                nRooVtxs->Clear();
+                nuTree->GetEntry(entry);
+                stats.AddEntry();
+                
+                for (int i = 0; i < NRooVtx; ++i) {
+                    ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+                    if (!vtx) continue;
+                    
+                    bool reconstructed = reconstructedEventIDs.find(vtx->EvtNum) != reconstructedEventIDs.end();
+                    if (recoOnly && !reconstructed) continue;
+                    
+                    stats.AddVertex(*vtx, reconstructed);
+                }
+            }
+            stats.EndUnit();
+        }
+        
+        nuTree->ResetBranchAddresses();
+        delete nRooVtxs;
+        file->Close();
+        delete file;
+    }
+    return true;
+}
+
+// Quick look at a random part of the input: either a fraction of the
+// clusters of all files, or an exact number of entries chosen by reservoir
+// sampling across all files. A fixed seed makes the selection reproducible.
+bool sampleFiles(const std::vector<std::string>& filenames, const SampleOptions& options) {
+    TStopwatch timer;
+    timer.Start();
+    
+    bool clusterSampling = options.reservoirSize == 0;
+    std::vector<Long64_t> fileEntries;
+    std::vector<WorkUnit> clusters;
+    if (!scanSampleInputs(filenames, clusterSampling, fileEntries, clusters)) {
+        return false;
+    }
+    
+    Long64_t totalEntries = 0;
+    for (size_t f = 0; f < fileEntries.size(); ++f) totalEntries += fileEntries[f];
+    if (totalEntries == 0) {
+        std::cerr << "No entries to sample" << std::endl;
+        return false;
+    }
+    
+    SampleRng rng(options.seed);
+    std::vector<WorkUnit> units;
+    double samplingFraction = 0;
+    
+    if (clusterSampling && clusters.size() >= MIN_SAMPLE_CLUSTERS) {
+        ULong64_t k = (ULong64_t)std::ceil(options.fraction * clusters.size());
+        std::vector<ULong64_t> chosen = chooseWithoutReplacement(rng, clusters.size(), k);
+        for (size_t i = 0; i < chosen.size(); ++i) {
+            units.push_back(clusters[chosen[i]]);
+        }
+        samplingFraction = (double)chosen.size() / clusters.size();
+        std::cout << "Sampling " << chosen.size() << " of " << clusters.size() << " clusters";
+    } else if (clusterSampling) {
+        std::cout << "Only " << clusters.size() << " cluster(s) in the input, sampling single entries instead" << std::endl;
+        ULong64_t k = (ULong64_t)std::ceil(options.fraction * totalEntries);
+        std::vector<ULong64_t> chosen = chooseWithoutReplacement(rng, totalEntries, k);
+        units = entriesToUnits(filenames, fileEntries, chosen);
+        samplingFraction = (double)chosen.size() / totalEntries;
+        std::cout << "Sampling " << chosen.size() << " of " << totalEntries << " entries";
+    } else {
+        EntryReservoir reservoir(options.reservoirSize, rng);
+        for (size_t f = 0; f < filenames.size(); ++f) {
+            for (Long64_t entry = 0; entry < fileEntries[f]; ++entry) {
+                reservoir.Offer((int)f, entry);
+            }
+        }
+        std::vector<EntryReservoir::Item> items = reservoir.GetSorted();
+        for (size_t i = 0; i < items.size(); ++i) {
+            WorkUnit unit;
+            unit.file.path = filenames[items[i].file];
+            unit.file.nEntries = fileEntries[items[i].file];
+            unit.begin = items[i].entry;
+            unit.end = unit.begin + 1;
+            units.push_back(unit);
+        }
+        samplingFraction = (double)items.size() / totalEntries;
+        std::cout << "Reservoir sample of " << items.size() << " of " << totalEntries << " entries";
+    }
+    std::cout << " from " << filenames.size() << " file(s), seed " << options.seed << std::endl;
+    
+    SampleStats stats;
+    bool hasRecoInfo = false;
+    if (!readSampleUnits(units, options.recoOnly, stats, hasRecoInfo)) {
+        return false;
+    }
+    timer.Stop();
+    
+    std::cout << "\n========== SAMPLE ==========\n";
+    stats.Print(std::cout, samplingFraction, totalEntries, hasRecoInfo && !options.recoOnly);
+    std::cout << "\nSampled in " << timer.RealTime() << " s" << std::endl;
+    return true;
+}
+
+// Options of the skim mode
+struct SkimOptions {
+    std::string output;              // skim file to write
+    bool recoOnly;                   // only vertices with an entry in the evt tree
+    std::set<int> nuPdgs;            // incoming neutrino PDG codes, all if empty
+    std::string evtCode;             // substring of EvtCode, any if empty
+    std::vector<std::string> fields; // NRooTrackerVtx members to keep, all if empty
+
+    SkimOptions() : recoOnly(false) {}
+
+    bool HasSelection() const { return recoOnly || !nuPdgs.empty() || !evtCode.empty(); }
+};
+
+// Columns read to decide which vertices pass the skim selection
+const char* SKIM_SELECTION_BRANCHES[] = {
+    "NVtx",
+    "Vtx.EvtNum",
+    "Vtx.EvtCode*",
+    "Vtx.StdHepN",
+    "Vtx.StdHepPdg*",
+    "Vtx.StdHepStatus*"
+};
+
+// Members a projected skim always keeps: the entry structure, the event
+// number the evt entries are matched with and the counters of the variable
+// length arrays
+const char* SKIM_KEPT_MEMBERS[] = {
+    "EvtNum",
+    "StdHepN",
+    "NEnvc",
+    "NEnvert",
+    "NEnvcvert",
+    "NFnvert",
+    "NFnstep"
+};
+
+// Branch patterns of a projection on 'fields', empty to keep every branch.
+// Fails if a field is not a member of the template file's class.
+bool skimBranchPatterns(const std::vector<std::string>& fields, const VtxSchema& schema,
+                        std::vector<std::string>& patterns) {
+    patterns.clear();
+    if (fields.empty()) return true;
+    
+    patterns.push_back("NVtx");
+    patterns.push_back("Vtx.fUniqueID");
+    patterns.push_back("Vtx.fBits");
+    for (size_t m = 0; m < sizeof(SKIM_KEPT_MEMBERS) / sizeof(SKIM_KEPT_MEMBERS[0]); ++m) {
+        if (schema.Has(SKIM_KEPT_MEMBERS[m])) patterns.push_back(std::string("Vtx.") + SKIM_KEPT_MEMBERS[m]);
+    }
+    for (size_t f = 0; f < fields.size(); ++f) {
+        if (!schema.Has(fields[f])) {
+            std::cerr << "Unknown NRooTrackerVtx member in --fields: " << fields[f] << std::endl;
+            return false;
+        }
+        // The wildcard also matches the sub-branches of arrays and strings
+        patterns.push_back("Vtx." + fields[f] + "*");
+    }
+    return true;
+}
+
+// Vertex selection of the skim mode. EvtCode decisions are remembered per
+// pooled string, as a file only has a few distinct event codes.
+class SkimSelection {
+public:
+    SkimSelection(const SkimOptions& options, const std::set<int>& reconstructedEventIDs) :
+        options(options), reconstructedEventIDs(reconstructedEventIDs) {}
+    
+    bool Pass(ND::NRooTrackerVtx& vtx) {
+        if (options.recoOnly && reconstructedEventIDs.find(vtx.EvtNum) == reconstructedEventIDs.end()) {
+            return false;
+        }
+        if (!options.nuPdgs.empty() && !options.nuPdgs.count(IncomingNuPdg(vtx))) {
+            return false;
+        }
+        if (!options.evtCode.empty()) {
+            std::map<StringHandle, bool>::const_iterator it = evtCodePass.find(vtx.EvtCodeId);
+            if (it == evtCodePass.end()) {
+                bool pass = StringPool::Instance().Get(vtx.EvtCodeId).find(options.evtCode) != std::string::npos;
+                it = evtCodePass.insert(std::make_pair(vtx.EvtCodeId, pass)).first;
+            }
+            if (!it->second) return false;
+        }
+        return true;
+    }
+    
+private:
+    // PDG code of the first initial state neutrino in StdHep, 0 if none
+    static int IncomingNuPdg(const ND::NRooTrackerVtx& vtx) {
+        if (vtx.StdHepPdg == nullptr || vtx.StdHepStatus == nullptr) return 0;
+        for (int j = 0; j < vtx.StdHepN; ++j) {
+            int apdg = std::abs(vtx.StdHepPdg[j]);
+            if (vtx.StdHepStatus[j] == 0 && (apdg == 12 || apdg == 14 || apdg == 16)) return vtx.StdHepPdg[j];
+        }
+        return 0;
+    }
+    
+    const SkimOptions& options;
+    const std::set<int>& reconstructedEventIDs;
+    std::map<StringHandle, bool> evtCodePass;
+};
+
+// The selected vertices of one entry
+struct SkimEntry {
+    Long64_t entry;
+    std::vector<int> vertices;
+    bool whole;  // every vertex of the entry was selected
+};
+
+// Find the selected vertices of every entry of nuTree, reading only the
+// selection columns. 'allPass' tells whether every vertex was selected.
+// Entries without vertices are kept, so a re-packed file keeps the same
+// entries as a whole file copy would.
+void selectSkimEntries(TTree* nuTree, SkimSelection& selection, std::vector<SkimEntry>& selected,
+                       std::set<int>& evtNums, bool& allPass) {
+    nuTree->SetBranchStatus("*", 0);
+    for (size_t b = 0; b < sizeof(SKIM_SELECTION_BRANCHES) / sizeof(SKIM_SELECTION_BRANCHES[0]); ++b) {
+        nuTree->SetBranchStatus(SKIM_SELECTION_BRANCHES[b], 1);
+    }
+    
+    TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+    int NRooVtx = 0;
+    nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+    nuTree->SetBranchAddress("NVtx", &NRooVtx);
+    
+    allPass = true;
+    Long64_t nEntries = nuTree->GetEntries();
+    for (Long64_t entry = 0; entry < nEntries; ++entry) {
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+        
+        SkimEntry passed;
+        passed.entry = entry;
+        passed.whole = true;
+        for (int i = 0; i < NRooVtx; ++i) {
+            ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+            if (vtx && selection.Pass(*vtx)) {
+                passed.vertices.push_back(i);
+                evtNums.insert(vtx->EvtNum);
+            } else {
+                passed.whole = false;
+                allPass = false;
+            }
+        }
+        if (NRooVtx == 0 || !passed.vertices.empty()) selected.push_back(passed);
+    }
+    
+    nuTree->ResetBranchAddresses();
+    delete nRooVtxs;
+}
+
+// Queue the selected entries of nuTree (file 'filename') for the writer.
+// Runs of clusters whose entries are all selected whole are copied by the
+// writer, basket by basket where possible. The other selected entries are
+// read with the projection 'patterns' and their selected vertices moved to
+// the writer.
+void writeSkimEntries(TTree* nuTree, const std::string& filename, const std::vector<std::string>& patterns,
+                      const std::vector<SkimEntry>& selected, SkimWriter& writer) {
+    nuTree->SetBranchStatus("*", 1);
+    if (!patterns.empty()) {
+        nuTree->SetBranchStatus("*", 0);
+        for (size_t p = 0; p < patterns.size(); ++p) {
+            nuTree->SetBranchStatus(patterns[p].c_str(), 1);
+        }
+    }
+    
+    TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+    int NRooVtx = 0;
+    nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+    nuTree->SetBranchAddress("NVtx", &NRooVtx);
+    
+    Long64_t nEntries = nuTree->GetEntries();
+    Long64_t runStart = -1, runEnd = -1;
+    size_t s = 0;
+    TTree::TClusterIterator clusters = nuTree->GetClusterIterator(0);
+    Long64_t clusterStart;
+    while ((clusterStart = clusters.Next()) < nEntries) {
+        Long64_t clusterEnd = clusters.GetNextEntry();
+        
+        // Selected entries of this cluster are [s, next)
+        size_t next = s;
+        bool whole = patterns.empty();
+        while (next < selected.size() && selected[next].entry < clusterEnd) {
+            if (!selected[next].whole) whole = false;
+            next++;
+        }
+        if (whole && (Long64_t)(next - s) == clusterEnd - clusterStart) {
+            if (runStart < 0) runStart = clusterStart;
+            runEnd = clusterEnd;
+            s = next;
+            continue;
+        }
+        
+        if (runStart >= 0) {
+            writer.CopyVertexRange(filename, runStart, runEnd);
+            runStart = runEnd = -1;
+        }
+        for (; s < next; ++s) {
+            nRooVtxs->Clear();
+            nuTree->GetEntry(selected[s].entry);
+            
+            // The vertices are read again for the next entry, so their arrays
+            // are moved rather than copied
+            std::unique_ptr<DecodedEntry> copy(new DecodedEntry());
+            copy->entry = selected[s].entry;
+            for (size_t v = 0; v < selected[s].vertices.size(); ++v) {
+                ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(selected[s].vertices[v]);
+                if (vtx) copy->vertices.push_back(new ND::NRooTrackerVtx(std::move(*vtx)));
+            }
+            writer.Write(std::move(copy));
+        }
+    }
+    if (runStart >= 0) writer.CopyVertexRange(filename, runStart, runEnd);
+    
+    nuTree->ResetBranchAddresses();
+    delete nRooVtxs;
+}
+
+// Write the selected vertices of all files, and the evt entries of their
+// events, to one skim file. Files in which every vertex passes are copied
+// basket by basket; the others are re-packed with only the selected vertices.
+// The output is written by a separate thread while the next entries are read.
+bool skimFiles(const std::vector<std::string>& filenames, const SkimOptions& options) {
+    ROOT::EnableThreadSafety();
+    
+    TStopwatch timer;
+    timer.Start();
+    
+    // The first file is the template of the output NRooTrackerVtx tree
+    std::vector<std::string> patterns;
+    {
+        TFile* file = TFile::Open(filenames[0].c_str(), "READ");
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error opening file: " << filenames[0] << std::endl;
+            delete file;
+            return false;
+        }
+        VtxSchema schema;
+        bool ok = openVtxSchema(file, filenames[0], schema) &&
+                  skimBranchPatterns(options.fields, schema, patterns);
+        file->Close();
+        delete file;
+        if (!ok) return false;
+    }
+    
+    SkimWriter writer;
+    if (!writer.Open(options.output, filenames[0], patterns)) {
+        return false;
+    }
+    
+    Long64_t nInputEntries = 0;
+    bool ok = true;
+    for (size_t f = 0; ok && f < filenames.size(); ++f) {
+        const std::string& filename = filenames[f];
+        TFile* file = TFile::Open(filename.c_str(), "READ");
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            delete file;
+            ok = false;
+            break;
+        }
+        TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+        if (!nuTree) {
+            std::cerr << "Tree 'NRooTrackerVtx' not found in file " << filename << std::endl;
+            file->Close();
+            delete file;
+            ok = false;
+            break;
+        }
+        VtxSchema schema;
+        if (!openVtxSchema(file, filename, schema)) {
+            file->Close();
+            delete file;
+            ok = false;
+            break;
+        }
+        nInputEntries += nuTree->GetEntries();
+        
+        if (!options.HasSelection()) {
+            writer.CopyVertices(filename);
+            writer.CopyAllEvents(filename);
+            file->Close();
+            delete file;
+            continue;
+        }
+        
+        std::set<int> reconstructedEventIDs;
+        TTree* evtTree = (TTree*)file->Get("evt");
+        if (evtTree) {
+            collectReconstructedEventIDs(evtTree, reconstructedEventIDs);
+        } else if (options.recoOnly) {
+            std::cerr << "Tree 'evt' not found in file " << filename << ", no vertex passes --reco-only" << std::endl;
+        }
+        
+        SkimSelection selection(options, reconstructedEventIDs);
+        std::vector<SkimEntry> selected;
+        std::set<int> evtNums;
+        bool allPass = false;
+        selectSkimEntries(nuTree, selection, selected, evtNums, allPass);
+        
+        if (allPass) {
+            writer.CopyVertices(filename);
+        } else {
+            writeSkimEntries(nuTree, filename, patterns, selected, writer);
+        }
+        writer.CopyEvents(filename, evtNums);
+        
+        std::cout << filename << ": " << selected.size() << " of " << nuTree->GetEntries()
+                  << " entries selected" << (allPass ? " (whole file)" : "") << std::endl;
+        
+        file->Close();
+        delete file;
+    }
+    
+    ok = writer.Close() && ok;
+    timer.Stop();
+    
+    std::cout << "\n========== SKIM ==========\n";
+    std::cout << "Output file:            " << options.output << std::endl;
+    std::cout << "Input entries:          " << nInputEntries << std::endl;
+    std::cout << "Written entries:        " << writer.GetNEntries()
+              << " (" << writer.GetNFastEntries() << " copied without decompression)" << std::endl;
+    std::cout << "Re-packed vertices:     " << writer.GetNVertices() << std::endl;
+    std::cout << "Written evt entries:    " << writer.GetNEvents() << std::endl;
+    std::cout << "\nSkimmed in " << timer.RealTime() << " s" << std::endl;
+    return ok;
+}
+
+// Options of the region mode
+struct RegionOptions {
+    std::string regionFile;  // detector regions, see DetectorRegions.h
+    std::string inRegion;    // only read entries that can have vertices in this region
+    bool recoOnly;
+    std::string cacheDir;    // per-file vertex box indices, empty to disable
+    int geomDepth;           // group the vertices in regions by this many GeomPath components, 0 for none
+
+    RegionOptions() : recoOnly(false), cacheDir(defaultCacheDir("vtxbox")), geomDepth(0) {}
+};
+
+// Columns read in region mode
+const char* REGION_BRANCHES[] = {
+    "NVtx",
+    "Vtx.EvtNum",
+    "Vtx.EvtWght",
+    "Vtx.EvtVtx*"
+};
+
+// Sub-detector of a GeomPath: its first 'depth' components, e.g.
+// "/t2k_1/OA_0/Magnet_0" for depth 3
+std::string geomPathGroup(const std::string& path, int depth) {
+    std::string group;
+    size_t pos = 0;
+    for (int d = 0; d < depth; ++d) {
+        while (pos < path.size() && path[pos] == '/') pos++;
+        if (pos >= path.size()) break;
+        size_t end = path.find('/', pos);
+        if (end == std::string::npos) end = path.size();
+        group += "/" + path.substr(pos, end - pos);
+        pos = end;
+    }
+    return group.empty() ? "(no GeomPath)" : group;
+}
+
+// Vertex positions waiting to be classified together, with the per region
+// counts they are added to. With a GeomPath depth, the vertices in the
+// selected regions are also counted per sub-detector.
+class RegionCounter {
+public:
+    RegionCounter(const DetectorRegions& regions, DetectorRegions::Mask selected, int geomDepth) :
+        regions(regions), selected(selected), geomDepth(geomDepth),
+        nVertices(regions.GetNRegions(), 0), sumWeight(regions.GetNRegions(), 0),
+        nOutside(0), nTotal(0) {}
+    
+    void Add(const double* position, double weight, StringHandle geomPath) {
+        x.push_back(position[0]);
+        y.push_back(position[1]);
+        z.push_back(position[2]);
+        w.push_back(weight);
+        paths.push_back(geomPath);
+        if (x.size() >= kBatchSize) Flush();
+    }
+    
+    // Vertices known to be outside the selected regions without their
+    // positions, e.g. those of entries skipped through the vertex box index
+    void AddOutside(Long64_t n) {
+        nOutside += n;
+        nTotal += n;
+    }
+    
+    void Flush() {
+        masks.resize(x.size());
+        regions.Classify(x.data(), y.data(), z.data(), x.size(), masks.data());
+        for (size_t i = 0; i < masks.size(); ++i) {
+            DetectorRegions::Mask mask = masks[i] & selected;
+            if (!mask) nOutside++;
+            if (mask && geomDepth > 0) {
+                size_t g = GroupOf(paths[i]);
+                groupVertices[g]++;
+                groupWeight[g] += w[i];
+            }
+            for (size_t r = 0; mask; ++r, mask >>= 1) {
+                if (!(mask & 1)) continue;
+                nVertices[r]++;
+                sumWeight[r] += w[i];
+            }
+        }
+        nTotal += x.size();
+        x.clear();
+        y.clear();
+        z.clear();
+        w.clear();
+        paths.clear();
+    }
+    
+    void Print(std::ostream& out, bool showOutside) const {
+        out << std::left << std::setw(24) << "Region" << std::right
+            << std::setw(14) << "Vertices" << std::setw(12) << "Fraction" << std::setw(16) << "Sum of weights" << std::endl;
+        for (size_t r = 0; r < nVertices.size(); ++r) {
+            if (!(selected & (DetectorRegions::Mask(1) << r))) continue;
+            PrintRow(out, regions.GetRegion(r).name, nVertices[r], sumWeight[r]);
+        }
+        if (showOutside) PrintRow(out, "(no region)", nOutside, -1);
+        if (geomDepth <= 0) return;
+        
+        out << std::endl << std::left << std::setw(24) << "GeomPath" << std::right
+            << std::setw(14) << "Vertices" << std::setw(12) << "Fraction" << std::setw(16) << "Sum of weights" << std::endl;
+        for (std::map<std::string, size_t>::const_iterator it = groupIndex.begin(); it != groupIndex.end(); ++it) {
+            PrintRow(out, it->first, groupVertices[it->second], groupWeight[it->second]);
+        }
+    }
+    
+private:
+    static const size_t kBatchSize = 4096;
+    
+    // Group of a pooled GeomPath. Vertices of a file share a few paths, so
+    // each path is split only the first time it is seen.
+    size_t GroupOf(StringHandle path) {
+        std::map<StringHandle, size_t>::const_iterator it = pathGroup.find(path);
+        if (it != pathGroup.end()) return it->second;
+        
+        std::string name = geomPathGroup(StringPool::Instance().Get(path), geomDepth);
+        std::map<std::string, size_t>::const_iterator named = groupIndex.find(name);
+        size_t g;
+        if (named != groupIndex.end()) {
+            g = named->second;
+        } else {
+            g = groupVertices.size();
+            groupIndex[name] = g;
+            groupVertices.push_back(0);
+            groupWeight.push_back(0);
+        }
+        pathGroup[path] = g;
+        return g;
+    }
+    
+    void PrintRow(std::ostream& out, const std::string& name, Long64_t n, double weight) const {
+        out << std::left << std::setw(24) << name << std::right << std::setw(14) << n
+            << std::setw(11) << std::fixed << std::setprecision(2) << (nTotal > 0 ? 100.0 * n / nTotal : 0) << "%";
+        if (weight >= 0) out << std::setw(16) << std::setprecision(4) << weight;
+        out.unsetf(std::ios::floatfield);
+        out << std::setprecision(6) << std::endl;
+    }
+    
+    const DetectorRegions& regions;
+    DetectorRegions::Mask selected;
+    int geomDepth;
+    std::vector<double> x, y, z, w;
+    std::vector<StringHandle> paths;
+    std::vector<DetectorRegions::Mask> masks;
+    std::vector<Long64_t> nVertices;
+    std::vector<double> sumWeight;
+    Long64_t nOutside;
+    Long64_t nTotal;
+    std::map<StringHandle, size_t> pathGroup;
+    std::map<std::string, size_t> groupIndex;
+    std::vector<Long64_t> groupVertices;
+    std::vector<double> groupWeight;
+};
+
+// Count the vertices of one file in each region. With a region restriction
+// and a cached index, only the entries whose vertex box meets the region are
+// read; otherwise all entries are read and the index is built on the way.
+// The vertices of skipped entries are still counted, from NVtx (and EvtNum
+// with --reco-only, in a second pass) alone, so the fractions do not depend
+// on the cache.
+bool countFileRegions(const std::string& filename, const RegionOptions& options, const DetectorRegions& regions,
+                      int region, RegionCounter& counter, Long64_t& nRead, Long64_t& nEntries) {
+    FileIdentity identity;
+    if (!statFileIdentity(filename, identity)) {
+        std::cerr << "Cannot access file: " << filename << std::endl;
+        return false;
+    }
+    TFile* file = TFile::Open(filename.c_str(), "READ");
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        delete file;
+        return false;
+    }
+    TTree* nuTree = (TTree*)file->Get("NRooTrackerVtx");
+    if (!nuTree) {
+        std::cerr << "Tree 'NRooTrackerVtx' not found in file " << filename << std::endl;
+        file->Close();
+        delete file;
+        return false;
+    }
+    VtxSchema schema;
+    if (!openVtxSchema(file, filename, schema)) {
+        file->Close();
+        delete file;
+        return false;
+    }
+    identity.nEntries = nuTree->GetEntries();
+    nEntries += identity.nEntries;
+    
+    std::set<int> reconstructedEventIDs;
+    if (options.recoOnly) {
+        TTree* evtTree = (TTree*)file->Get("evt");
+        if (evtTree) {
+            collectReconstructedEventIDs(evtTree, reconstructedEventIDs);
+        } else {
+            std::cerr << "Tree 'evt' not found in file " << filename << ", no vertex passes --reco-only" << std::endl;
+        }
+    }
+    
+    VtxBoxIndex index;
+    bool cached = !options.cacheDir.empty() && index.Read(options.cacheDir, identity) &&
+                  index.GetIdentity() == identity;
+    if (!cached) index.Reset(identity);
+    bool useIndex = cached && region >= 0;
+    
+    nuTree->SetBranchStatus("*", 0);
+    for (size_t b = 0; b < sizeof(REGION_BRANCHES) / sizeof(REGION_BRANCHES[0]); ++b) {
+        nuTree->SetBranchStatus(REGION_BRANCHES[b], 1);
+    }
+    if (options.geomDepth > 0) nuTree->SetBranchStatus("Vtx.GeomPath*", 1);
+    
+    TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+    int NRooVtx = 0;
+    nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+    nuTree->SetBranchAddress("NVtx", &NRooVtx);
+    TBranch* nVtxBranch = nuTree->GetBranch("NVtx");
+    
+    // Skipped entries whose reconstructed vertices are counted afterwards
+    std::vector<Long64_t> skipped;
+    
+    for (Long64_t entry = 0; entry < identity.nEntries; ++entry) {
+        if (useIndex && !index.Overlaps(entry, regions.GetRegion(region).min, regions.GetRegion(region).max)) {
+            if (options.recoOnly) {
+                skipped.push_back(entry);
+            } else {
+                nVtxBranch->GetEntry(entry);
+                counter.AddOutside(NRooVtx);
+            }
+            continue;
+        }
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+        nRead++;
+        
+        for (int i = 0; i < NRooVtx; ++i) {
+            ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+            if (!vtx) continue;
+            if (!cached) index.Add(entry, vtx->EvtVtx[0], vtx->EvtVtx[1], vtx->EvtVtx[2]);
+            if (options.recoOnly && reconstructedEventIDs.find(vtx->EvtNum) == reconstructedEventIDs.end()) continue;
+            counter.Add(vtx->EvtVtx, vtx->EvtWght, vtx->GeomPathId);
+        }
+    }
+    
+    // The event numbers of the skipped entries, read through the whole
+    // entry so that NVtx and the vertices stay consistent
+    if (!skipped.empty()) {
+        nuTree->SetBranchStatus("*", 0);
+        nuTree->SetBranchStatus("NVtx", 1);
+        nuTree->SetBranchStatus("Vtx.EvtNum", 1);
+        for (size_t s = 0; s < skipped.size(); ++s) {
+            nRooVtxs->Clear();
+            nuTree->GetEntry(skipped[s]);
+            Long64_t nReconstructed = 0;
+            for (int i = 0; i < NRooVtx; ++i) {
+                ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+                if (vtx && reconstructedEventIDs.find(vtx->EvtNum) != reconstructedEventIDs.end()) nReconstructed++;
+            }
+            counter.AddOutside(nReconstructed);
+        }
+    }
+    
+    nuTree->ResetBranchAddresses();
+    delete nRooVtxs;
+    file->Close();
+    delete file;
+    
+    if (!cached && !options.cacheDir.empty()) index.Write(options.cacheDir);
+    return true;
+}
+
+// Number and weight of the vertices in each detector region
+bool regionFiles(const std::vector<std::string>& filenames, const RegionOptions& options) {
+    DetectorRegions regions;
+    if (!regions.Load(options.regionFile)) {
+        return false;
+    }
+    std::cout << "Regions from " << options.regionFile << ":" << std::endl;
+    regions.Print(std::cout);
+    
+    int region = -1;
+    DetectorRegions::Mask selected = ~DetectorRegions::Mask(0);
+    if (!options.inRegion.empty()) {
+        region = regions.Find(options.inRegion);
+        if (region < 0) {
+            std::cerr << "No region named " << options.inRegion << " in " << options.regionFile << std::endl;
+            return false;
+        }
+        selected = DetectorRegions::Mask(1) << region;
+    }
+    
+    TStopwatch timer;
+    timer.Start();
+    
+    RegionCounter counter(regions, selected, options.geomDepth);
+    Long64_t nRead = 0, nEntries = 0;
+    for (size_t f = 0; f < filenames.size(); ++f) {
+        if (!countFileRegions(filenames[f], options, regions, region, counter, nRead, nEntries)) {
+            return false;
+        }
+    }
+    counter.Flush();
+    timer.Stop();
+    
+    std::cout << "\n========== REGIONS ==========\n";
+    counter.Print(std::cout, region < 0);
+    std::cout << "\nRead " << nRead << " of " << nEntries << " entries in " << timer.RealTime() << " s" << std::endl;
+    return true;
+}
+
+// Options of the ordered dump mode
+struct DumpOptions {
+    bool recoOnly;      // only print vertices with an entry in the evt tree
+    int threads;        // worker threads, 0 for one per core
+    Long64_t unitSize;  // target number of entries per unit
+    size_t window;      // units buffered ahead of the writer, 0 for two per thread
+
+    DumpOptions() : recoOnly(false), threads(0), unitSize(1000), window(0) {}
+};
+
+// What the workers need to know about one input file
+struct DumpFile {
+    VertexPrinter printer;
+    std::set<int> reconstructedEventIDs;
+};
+
+// Format the vertices of one unit into 'out', exactly as the interactive mode
+// prints them
+void dumpUnit(TTree* nuTree, TClonesArray* nRooVtxs, const int& NRooVtx, const WorkUnit& unit,
+              const DumpFile& info, bool recoOnly, std::ostream& out) {
+    for (Long64_t entry = unit.begin; entry < unit.end; ++entry) {
+        nRooVtxs->Clear();
+        nuTree->GetEntry(entry);
+        
+        for (int i = 0; i < NRooVtx; ++i) {
+            ND::NRooTrackerVtx* vtx = (ND::NRooTrackerVtx*)nRooVtxs->At(i);
+            if (!vtx) continue;
+            
+            bool reconstructed = info.reconstructedEventIDs.find(vtx->EvtNum) != info.reconstructedEventIDs.end();
+            if (recoOnly && !reconstructed) continue;
+            
+            info.printer(out, entry, i, vtx, recoOnly);
+        }
+    }
+}
+
+// Print every vertex of all files in (file, entry, vertex) order. Units of
+// entries are formatted in parallel, each thread reading through its own
+// TFile, and a reorder buffer hands the text to this thread in unit order,
+// so the output is the same for any number of threads.
+bool dumpFiles(const std::vector<std::string>& filenames, DumpOptions options) {
+    if (options.threads <= 0) {
+        options.threads = (int)std::thread::hardware_concurrency();
+        if (options.threads <= 0) options.threads = 1;
+    }
+    if (options.window == 0) options.window = 2 * (size_t)options.threads;
+    ROOT::EnableThreadSafety();
+    
+    // Text printed before unit u: the headers of the files that start there,
+    // with the names they were given, including those of empty files, which
+    // have no units. headers[units.size()] follows the last unit.
+    std::vector<WorkUnit> units;
+    std::vector<std::string> headers;
+    for (size_t f = 0; f < filenames.size(); ++f) {
+        std::vector<WorkUnit> fileUnits;
+        if (!planSummaryUnits(std::vector<std::string>(1, filenames[f]), options.unitSize, fileUnits)) {
+            return false;
+        }
+        headers.resize(units.size() + 1);
+        headers[units.size()] += "\n===== " + filenames[f] + " =====\n";
+        units.insert(units.end(), fileUnits.begin(), fileUnits.end());
+    }
+    headers.resize(units.size() + 1);
+    
+    // Layout and reconstructed events of every file, read once up front
+    std::map<std::string, DumpFile> files;
+    for (size_t u = 0; u < units.size(); ++u) {
+        const std::string& path = units[u].file.path;
+        if (files.count(path)) continue;
+        
+        TFile* file = TFile::Open(path.c_str(), "READ");
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error opening file: " << path << std::endl;
+            delete file;
+            return false;
+        }
+        VtxSchema schema;
+        if (!openVtxSchema(file, path, schema)) {
+            file->Close();
+            delete file;
+            return false;
+        }
+        DumpFile& info = files[path];
+        SelectVertexPrinter select;
+        dispatchVtxLayout(schema, select);
+        info.printer = select.printer;
+        
+        TTree* evtTree = (TTree*)file->Get("evt");
+        if (evtTree) {
+            collectReconstructedEventIDs(evtTree, info.reconstructedEventIDs);
+        } else if (options.recoOnly) {
+            std::cerr << "Tree 'evt' not found in file " << path << ", no vertex passes --reco-only" << std::endl;
+        }
+        file->Close();
+        delete file;
+    }
+    
+    ReorderBuffer<std::string> output(options.window);
+    output.Close(units.size());
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    
+    // Each thread takes the next unit and keeps its file open for the
+    // following units of the same file
+    auto worker = [&]() {
+        TFile* file = nullptr;
+        TTree* nuTree = nullptr;
+        TClonesArray* nRooVtxs = new TClonesArray("ND::NRooTrackerVtx");
+        int NRooVtx = 0;
+        std::string openPath;
+        
+        size_t u;
+        while ((u = next++) < units.size()) {
+            const WorkUnit& unit = units[u];
+            if (unit.file.path != openPath) {
+                if (file) {
+                    nuTree->ResetBranchAddresses();
+                    file->Close();
+                    delete file;
+                }
+                openPath = unit.file.path;
+                file = TFile::Open(openPath.c_str(), "READ");
+                nuTree = file && !file->IsZombie() ? (TTree*)file->Get("NRooTrackerVtx") : nullptr;
+                if (!nuTree || nuTree->GetEntries() != unit.file.nEntries) {
+                    std::cerr << "File changed since its units were planned: " << openPath << std::endl;
+                    failed = true;
+                    output.Abort();
+                    break;
+                }
+                nuTree->SetBranchAddress("Vtx", &nRooVtxs);
+                nuTree->SetBranchAddress("NVtx", &NRooVtx);
+            }
+            
+            std::ostringstream text;
+            dumpUnit(nuTree, nRooVtxs, NRooVtx, unit, files.find(unit.file.path)->second, options.recoOnly, text);
+            if (!output.Put(u, text.str())) break;
+        }
+        
+        if (nuTree) nuTree->ResetBranchAddresses();
+        if (file) file->Close();
+        delete file;
+        delete nRooVtxs;
+    };
+    
+    int nThreads = options.threads < (int)units.size() ? options.threads : (int)units.size();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.push_back(std::thread(worker));
+    }
+    
+    std::string text;
+    size_t taken = 0;
+    while (output.Take(text)) {
+        std::cout << headers[taken++] << text;
+    }
+    if (taken == units.size()) std::cout << headers[taken];
+    std::cout.flush();
+    
+    for (size_t t = 0; t < threads.size(); ++t) {
+        threads[t].join();
+    }
+    return !failed;
+}
+
+// Path of the running executable, used to start worker processes
+std::string selfExecutable(const char* argv0) {
+    char path[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (len <= 0) return argv0;
+    path[len] = '\0';
+    return path;
+}
+
+// Options of the POT (exposure) scan mode
+struct PotOptions {
+    int threads;            // files scanned at once, 0 for one per core
+    std::string cacheDir;   // per-file result cache, empty to disable
+    bool listSources;       // list every original file in the report
+
+    PotOptions() : threads(0), cacheDir(defaultPotCacheDir()), listSources(false) {}
+};
+
+// Total POT and provenance of a set of files, from the provenance members only
+bool potScanFiles(const std::vector<std::string>& filenames, PotOptions options) {
+    if (options.threads <= 0) {
+        options.threads = (int)std::thread::hardware_concurrency();
+        if (options.threads <= 0) options.threads = 1;
+    }
+    
+    TStopwatch timer;
+    timer.Start();
+    
+    std::vector<FilePot> results;
+    if (!scanPotFiles(filenames, options.threads, options.cacheDir, results)) {
+        return false;
+    }
+    printPotReport(std::cout, results, options.listSources);
+    
+    timer.Stop();
+    std::cout << "\nScanned " << filenames.size() << " files in " << timer.RealTime() << " s" << std::endl;
+    return true;
+}
+
+// Print the NRooTrackerVtx layout every file was written with. Returns false
+// if a file cannot be read with the compiled class.
+bool printSchemas(const std::vector<std::string>& filenames) {
+    bool allCompatible = true;
+    for (size_t f = 0; f < filenames.size(); ++f) {
+        TFile* file = TFile::Open(filenames[f].c_str(), "READ");
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error opening file: " << filenames[f] << std::endl;
+            return false;
+        }
+        
+        std::cout << "===== " << filenames[f] << " =====" << std::endl;
+        VtxSchema schema;
+        if (readVtxSchema(file, schema)) {
+            printVtxSchema(std::cout, schema);
+            std::ostringstream problems;
+            allCompatible = checkVtxSchema(schema, problems) && allCompatible;
+        } else {
+            std::cout << "No streamer info for ND::NRooTrackerVtx" << std::endl;
+            allCompatible = false;
+        }
+        
+        file->Close();
+        delete file;
+    }
+    return allCompatible;
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <root_file>" << std::endl;
+    std::cerr << "       " << program << " --summary [options] <root_file> [<root_file> ...]" << std::endl;
+    std::cerr << "       " << program << " --shard-plan <dir> [options] <root_file> [<root_file> ...]" << std::endl;
+    std::cerr << "       " << program << " --shard-worker <dir> <rank> <nranks>" << std::endl;
+    std::cerr << "       " << program << " --shard-merge <dir>" << std::endl;
+    std::cerr << "       " << program << " --sample <fraction> | --reservoir <n> [--seed <n>] [--reco-only] <root_file> [...]" << std::endl;
+    std::cerr << "       " << program << " --schema <root_file> [<root_file> ...]" << std::endl;
+    std::cerr << "       " << program << " --pot [options] <root_file> [<root_file> ...]" << std::endl;
+    std::cerr << "       " << program << " --skim <out_file> [options] <root_file> [<root_file> ...]" << std::endl;
+    std::cerr << "       " << program << " --regions <region_file> [options] <root_file> [<root_file> ...]" << std::endl;
+    std::cerr << "       " << program << " --dump [options] <root_file> [<root_file> ...]" << std::endl;
+    std::cerr << "\nSummary options:" << std::endl;
+    std::cerr << "  --reco-only           only count vertices with reconstruction data in the evt tree" << std::endl;
+    std::cerr << "  --checkpoint <file>   journal of completed units; a rerun only processes missing units" << std::endl;
+    std::cerr << "  --unit-size <n>       target number of entries per unit (default: 10000)" << std::endl;
+    std::cerr << "  --jobs <n>            run n local worker processes and merge their results" << std::endl;
+    std::cerr << "  --shard-dir <dir>     directory shared with the workers (default: temporary)" << std::endl;
+    std::cerr << "\nSampling options:" << std::endl;
+    std::cerr << "  --sample <fraction>   statistics from a random fraction (0-1] of the clusters" << std::endl;
+    std::cerr << "  --reservoir <n>       statistics from exactly n random entries across all files" << std::endl;
+    std::cerr << "  --seed <n>            random seed (default: 12345)" << std::endl;
+    std::cerr << "\nPOT scan options:" << std::endl;
+    std::cerr << "  --jobs <n>            files scanned at once (default: one per core)" << std::endl;
+    std::cerr << "  --pot-cache <dir>     per-file result cache (default: ~/.cache/root_reader/pot)" << std::endl;
+    std::cerr << "  --no-pot-cache        neither use nor fill the cache" << std::endl;
+    std::cerr << "  --list-sources        list every original file (OrigFileName) in the report" << std::endl;
+    std::cerr << "\nSkim options:" << std::endl;
+    std::cerr << "  --reco-only           only keep vertices with reconstruction data in the evt tree" << std::endl;
+    std::cerr << "  --nu-pdg <pdg>        only keep vertices with this incoming neutrino (repeatable)" << std::endl;
+    std::cerr << "  --evt-code <text>     only keep vertices whose EvtCode contains this text" << std::endl;
+    std::cerr << "  --fields <a,b,...>    only write these NRooTrackerVtx members (default: all)" << std::endl;
+    std::cerr << "\nRegion options:" << std::endl;
+    std::cerr << "  --reco-only           only count vertices with reconstruction data in the evt tree" << std::endl;
+    std::cerr << "  --in-region <name>    only count this region and skip entries outside it" << std::endl;
+    std::cerr << "  --index-cache <dir>   per-file vertex box indices (default: ~/.cache/root_reader/vtxbox)" << std::endl;
+    std::cerr << "  --no-index-cache      neither use nor fill the index cache" << std::endl;
+    std::cerr << "  --geom-depth <n>      also count the vertices in the regions per GeomPath prefix of n components" << std::endl;
+    std::cerr << "\nDump options (all vertices, printed as in the interactive mode, in file and entry order):" << std::endl;
+    std::cerr << "  --reco-only           only print vertices with reconstruction data in the evt tree" << std::endl;
+    std::cerr << "  --jobs <n>            formatting threads (default: one per core)" << std::endl;
+    std::cerr << "  --unit-size <n>       target number of entries per unit of work (default: 1000)" << std::endl;
+    std::cerr << "  --window <n>          units formatted ahead of the output (default: two per thread)" << std::endl;
+}
+
+// Parse a non-negative integer command line value
+bool parseCount(const char* text, Long64_t& value) {
+    try {
+        size_t used = 0;
+        value = std::stoll(text, &used);
+        return used == std::string(text).size() && value >= 0;
+    } catch (...) {
+        return false;
+    }
+}
+
+// Split a comma separated command line value, skipping empty items
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    std::string firstArg = argv[1];
+    if (firstArg == "--shard-worker") {
+        Long64_t rank = 0, nRanks = 0;
+        if (argc != 5 || !parseCount(argv[3], rank) || !parseCount(argv[4], nRanks) || rank >= nRanks) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return runShardWorker(argv[2], (int)rank, (int)nRanks) ? 0 : 1;
+    }
+    if (firstArg == "--shard-merge") {
+        if (argc != 3) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return mergeShards(argv[2]) ? 0 : 1;
+    }
+    
+    bool summaryMode = false;
+    bool planOnly = false;
+    bool sampleMode = false;
+    bool schemaMode = false;
+    bool potMode = false;
+    bool dumpMode = false;
+    bool jobsGiven = false;
+    bool unitSizeGiven = false;
+    SkimOptions skimOptions;
+    RegionOptions regionOptions;
+    DumpOptions dumpOptions;
+    SummaryOptions summaryOptions;
+    SampleOptions sampleOptions;
+    PotOptions potOptions;
+    std::vector<std::string> filenames;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        Long64_t value = 0;
+        if (arg == "--summary") {
+            summaryMode = true;
+        } else if (arg == "--schema") {
+            schemaMode = true;
+        } else if (arg == "--pot") {
+            potMode = true;
+        } else if (arg == "--dump") {
+            dumpMode = true;
+        } else if (arg == "--window" && i + 1 < argc) {
+            if (!parseCount(argv[++i], value) || value == 0) {
+                std::cerr << "Invalid window size: " << argv[i] << std::endl;
+                return 1;
+            }
+            dumpOptions.window = (size_t)value;
+        } else if (arg == "--pot-cache" && i + 1 < argc) {
+            potOptions.cacheDir = argv[++i];
+        } else if (arg == "--no-pot-cache") {
+            potOptions.cacheDir.clear();
+        } else if (arg == "--list-sources") {
+            potOptions.listSources = true;
+        } else if (arg == "--skim" && i + 1 < argc) {
+            skimOptions.output = argv[++i];
+        } else if (arg == "--nu-pdg" && i + 1 < argc) {
+            int pdg = 0;
+            bool valid = false;
+            try {
+                size_t used = 0;
+                pdg = std::stoi(argv[++i], &used);
+                valid = used == std::string(argv[i]).size();
+            } catch (...) {
+                valid = false;
+            }
+            if (!valid) {
+                std::cerr << "Invalid PDG code: " << argv[i] << std::endl;
+                return 1;
+            }
+            skimOptions.nuPdgs.insert(pdg);
+        } else if (arg == "--regions" && i + 1 < argc) {
+            regionOptions.regionFile = argv[++i];
+        } else if (arg == "--in-region" && i + 1 < argc) {
+            regionOptions.inRegion = argv[++i];
+        } else if (arg == "--index-cache" && i + 1 < argc) {
+            regionOptions.cacheDir = argv[++i];
+        } else if (arg == "--no-index-cache") {
+            regionOptions.cacheDir.clear();
+        } else if (arg == "--geom-depth" && i + 1 < argc) {
+            if (!parseCount(argv[++i], value) || value == 0) {
+                std::cerr << "Invalid GeomPath depth: " << argv[i] << std::endl;
+                return 1;
+            }
+            regionOptions.geomDepth = (int)value;
+        } else if (arg == "--evt-code" && i + 1 < argc) {
+            skimOptions.evtCode = argv[++i];
+        } else if (arg == "--fields" && i + 1 < argc) {
+            skimOptions.fields = splitList(argv[++i]);
+        } else if (arg == "--reco-only") {
+            summaryOptions.recoOnly = true;
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            summaryOptions.checkpointFile = argv[++i];
+        } else if (arg == "--unit-size" && i + 1 < argc) {
+            if (!parseCount(argv[++i], value) || value == 0) {
+                std::cerr << "Invalid unit size: " << argv[i] << std::endl;
+                return 1;
+            }
+            summaryOptions.unitSize = value;
+            unitSizeGiven = true;
+        } else if (arg == "--jobs" && i + 1 < argc) {
+            if (!parseCount(argv[++i], value) || value == 0) {
+                std::cerr << "Invalid number of jobs: " << argv[i] << std::endl;
+                return 1;
+            }
+            summaryOptions.jobs = (int)value;
+            jobsGiven = true;
+        } else if ((arg == "--shard-dir" || arg == "--shard-plan") && i + 1 < argc) {
+            summaryOptions.shardDir = argv[++i];
+            if (arg == "--shard-plan") planOnly = true;
+        } else if (arg == "--sample" && i + 1 < argc) {
+            try {
+                sampleOptions.fraction = std::stod(argv[++i]);
+            } catch (...) {
+                sampleOptions.fraction = 0;
+            }
+            if (!(sampleOptions.fraction > 0 && sampleOptions.fraction <= 1)) {
+                std::cerr << "Invalid sampling fraction: " << argv[i] << std::endl;
+                return 1;
+            }
+            sampleMode = true;
+        } else if (arg == "--reservoir" && i + 1 < argc) {
+            if (!parseCount(argv[++i], value) || value == 0) {
+                std::cerr << "Invalid reservoir size: " << argv[i] << std::endl;
+                return 1;
+            }
+            sampleOptions.reservoirSize = value;
+            sampleMode = true;
+        } else if (arg == "--seed" && i + 1 < argc) {
+            if (!parseCount(argv[++i], value)) {
+                std::cerr << "Invalid seed: " << argv[i] << std::endl;
+                return 1;
+            }
+            sampleOptions.seed = (ULong64_t)value;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        } else {
+            filenames.push_back(arg);
+        }
+    }
+    
+    if (filenames.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    if (potMode) {
+        if (jobsGiven) potOptions.threads = summaryOptions.jobs;
+        return potScanFiles(filenames, potOptions) ? 0 : 1;
+    }
+    
+    if (schemaMode) {
+        return printSchemas(filenames) ? 0 : 1;
+    }
+    
+    if (dumpMode) {
+        dumpOptions.recoOnly = summaryOptions.recoOnly;
+        if (jobsGiven) dumpOptions.threads = summaryOptions.jobs;
+        if (unitSizeGiven) dumpOptions.unitSize = summaryOptions.unitSize;
+        return dumpFiles(filenames, dumpOptions) ? 0 : 1;
+    }
+    
+    if (!regionOptions.regionFile.empty()) {
+        regionOptions.recoOnly = summaryOptions.recoOnly;
+        return regionFiles(filenames, regionOptions) ? 0 : 1;
+    }
+    
+    if (!skimOptions.output.empty()) {
+        skimOptions.recoOnly = summaryOptions.recoOnly;
+        return skimFiles(filenames, skimOptions) ? 0 : 1;
+    }
+    
+    if (sampleMode) {
+        if (sampleOptions.fraction > 0 && sampleOptions.reservoirSize > 0) {
+            std::cerr << "Use either --sample or --reservoir" << std::endl;
+            return 1;
+        }
+        sampleOptions.recoOnly = summaryOptions.recoOnly;
+        return sampleFiles(filenames, sampleOptions) ? 0 : 1;
+    }
+    
+    if (planOnly) {
+        ShardPlan plan;
+        return planShards(filenames, summaryOptions, plan) ? 0 : 1;
+    }
+    
+    if (summaryMode) {
+        if (summaryOptions.jobs > 1 || !summaryOptions.shardDir.empty()) {
+            if (!summaryOptions.checkpointFile.empty()) {
+                std::cerr << "--checkpoint cannot be combined with sharded execution; "
+                          << "rerun with the same --shard-dir to resume instead" << std::endl;
+                return 1;
+            }
+            return summarizeFilesSharded(filenames, summaryOptions, selfExecutable(argv[0])) ? 0 : 1;
+        }
+        return summarizeFiles(filenames, summaryOptions) ? 0 : 1;
+    }
+    
+    processRootFile(filenames[0]);
+    
+    return 0;
+}